@@ -0,0 +1,164 @@
+/* .Call binding of reduce_api.h for R. Each result is allocated as an R
+ * vector and filled in place by libreduce.so, and the vectors passed in
+ * are read in place, so nothing is copied or printed. Build it with
+ * `USE_MPI=0 make reduce_r` in src; reduce_api.R loads it. */
+#include <string.h>
+#include <R.h>
+#include <Rinternals.h>
+#include <R_ext/Rdynload.h>
+
+#include "reduce_api.h"
+
+static void check(int rc)
+{
+	if (rc != 0) {
+		error("%s", rapi_error());
+	}
+}
+
+/* .Call passes anything, so everything is checked before its data are read */
+static SEXP doubles(SEXP x, const char *what)
+{
+	if (TYPEOF(x) != REALSXP) {
+		error("%s must be a double vector", what);
+	}
+	return x;
+}
+
+static const char *string(SEXP x, const char *what)
+{
+	if (!isString(x) || XLENGTH(x) < 1) {
+		error("%s must be a string", what);
+	}
+	return CHAR(STRING_ELT(x, 0));
+}
+
+static int op_of(SEXP op)
+{
+	const char *s = string(op, "op");
+	if (strcmp(s, "sum") == 0) {
+		return RAPI_SUM;
+	}
+	if (strcmp(s, "prod") == 0) {
+		return RAPI_PROD;
+	}
+	error("op must be \"sum\" or \"prod\", not \"%s\"", s);
+	return -1;
+}
+
+SEXP r_rapi_generate(SEXP distr, SEXP seed, SEXP n)
+{
+	SEXP out = PROTECT(allocVector(REALSXP, (R_xlen_t) asReal(n)));
+	check(rapi_generate(string(distr, "distr"), (unsigned int) asReal(seed),
+	                    (long long) XLENGTH(out), REAL(out)));
+	UNPROTECT(1);
+	return out;
+}
+
+/* count shapes, one after another in a raw vector, with their number of
+ * leaves in its "leaves" attribute as well as in each shape */
+SEXP r_rapi_shapes(SEXP n, SEXP seed, SEXP count)
+{
+	long long leaves = (long long) asReal(n), c = (long long) asReal(count);
+	SEXP out;
+	if (leaves < 1 || c < 0) {
+		error("n must be positive and count not negative");
+	}
+	out = PROTECT(allocVector(RAWSXP, (R_xlen_t) (c * rapi_shape_words(leaves) * 8)));
+	check(rapi_shapes(leaves, (unsigned int) asReal(seed), c, (uint64_t *) RAW(out)));
+	setAttrib(out, install("leaves"), ScalarReal((double) leaves));
+	UNPROTECT(1);
+	return out;
+}
+
+/* c(value, exponent, height), left-associative if shapes is NULL, else in
+ * shape number which (from 1) of shapes */
+SEXP r_rapi_eval(SEXP a, SEXP op, SEXP shapes, SEXP which)
+{
+	long long n = (long long) XLENGTH(doubles(a, "a")), w = rapi_shape_words(n), k, height;
+	const uint64_t *shape = NULL;
+	SEXP leaves, out;
+	if (!isNull(shapes)) {
+		if (TYPEOF(shapes) != RAWSXP) {
+			error("shapes must be a raw vector from rapi_shapes");
+		}
+		leaves = getAttrib(shapes, install("leaves"));
+		if (isNull(leaves) || asReal(leaves) != (double) n) {
+			error("shapes are not over %lld leaves", n);
+		}
+		k = (long long) asReal(which) - 1;
+		if (k < 0 || (k + 1) * w * 8 > (long long) XLENGTH(shapes)) {
+			error("shapes has no shape %lld over %lld leaves", k + 1, n);
+		}
+		shape = (const uint64_t *) RAW(shapes) + k * w;
+	}
+	out = PROTECT(allocVector(REALSXP, 3));
+	check(rapi_eval(REAL(a), n, op_of(op), shape, &REAL(out)[0], &REAL(out)[1], &height));
+	REAL(out)[2] = (double) height;
+	UNPROTECT(1);
+	return out;
+}
+
+/* c(value, exponent) */
+SEXP r_rapi_exact(SEXP a, SEXP op)
+{
+	SEXP out = PROTECT(allocVector(REALSXP, 2));
+	check(rapi_exact(REAL(doubles(a, "a")), (long long) XLENGTH(a), op_of(op), &REAL(out)[0], &REAL(out)[1]));
+	UNPROTECT(1);
+	return out;
+}
+
+SEXP r_rapi_errors(SEXP a, SEXP op, SEXP val, SEXP exp2)
+{
+	SEXP out;
+	doubles(a, "a");
+	doubles(val, "val");
+	if (!isNull(exp2) && XLENGTH(doubles(exp2, "exp2")) != XLENGTH(val)) {
+		error("exp2 must be as long as val");
+	}
+	out = PROTECT(allocVector(REALSXP, XLENGTH(val)));
+	check(rapi_errors(REAL(a), (long long) XLENGTH(a), op_of(op), REAL(val),
+	                  isNull(exp2) ? NULL : REAL(exp2), (long long) XLENGTH(val), REAL(out)));
+	UNPROTECT(1);
+	return out;
+}
+
+/* list(fora, rola, rora, fora_height, rora_height) */
+SEXP r_rapi_trials(SEXP a, SEXP op, SEXP seed, SEXP iters)
+{
+	R_xlen_t m = (R_xlen_t) asReal(iters);
+	const char *names[] = {"fora", "rola", "rora", "fora_height", "rora_height", ""};
+	SEXP out;
+	doubles(a, "a");
+	if (m < 0) {
+		error("iters must not be negative");
+	}
+	out = PROTECT(mkNamed(VECSXP, names));
+	SET_VECTOR_ELT(out, 0, allocVector(REALSXP, m));
+	SET_VECTOR_ELT(out, 1, allocVector(REALSXP, m));
+	SET_VECTOR_ELT(out, 2, allocVector(REALSXP, m));
+	SET_VECTOR_ELT(out, 3, allocVector(INTSXP, m));
+	SET_VECTOR_ELT(out, 4, allocVector(INTSXP, m));
+	check(rapi_trials(REAL(a), (long long) XLENGTH(a), op_of(op), (unsigned int) asReal(seed),
+	                  (long long) m, REAL(VECTOR_ELT(out, 0)), REAL(VECTOR_ELT(out, 1)),
+	                  REAL(VECTOR_ELT(out, 2)), INTEGER(VECTOR_ELT(out, 3)),
+	                  INTEGER(VECTOR_ELT(out, 4))));
+	UNPROTECT(1);
+	return out;
+}
+
+static const R_CallMethodDef calls[] = {
+	{"r_rapi_generate", (DL_FUNC) &r_rapi_generate, 3},
+	{"r_rapi_shapes",   (DL_FUNC) &r_rapi_shapes,   3},
+	{"r_rapi_eval",     (DL_FUNC) &r_rapi_eval,     4},
+	{"r_rapi_exact",    (DL_FUNC) &r_rapi_exact,    2},
+	{"r_rapi_errors",   (DL_FUNC) &r_rapi_errors,   4},
+	{"r_rapi_trials",   (DL_FUNC) &r_rapi_trials,   4},
+	{NULL, NULL, 0}
+};
+
+void R_init_reduce_api(DllInfo *dll)
+{
+	R_registerRoutines(dll, NULL, calls, NULL, NULL);
+	R_useDynamicSymbols(dll, FALSE);
+}
@@ -5,6 +5,9 @@
 #define ASSOC_CXX
 
 #include "assoc.hxx"
+#include "running_error.hxx"
+#include "scaled_prod.hxx"
+#include "subnormal.hxx"
 
 #include <boost/multiprecision/mpfr.hpp>
 
@@ -145,7 +148,7 @@ void random_reduction_tree<FLOAT_T, ALLOC>::eval_tree_product(typename tree<FLOA
 	if (isnan(*c)) { // If not NaN then eval is done
 		s = t_.begin(c);
 		while (s != t_.end(c)) {
-			eval_tree_sum(s);
+			eval_tree_product(s);
 			acc *= *s;
 			s++;
 		}
@@ -210,6 +213,10 @@ changed_t random_reduction_tree<FLOAT_T, ALLOC>::grow_random_binary_tree(long le
 /* Explicit template instantiation. */
 template class random_reduction_tree<double>;
 template class random_reduction_tree<float>;
+template class random_reduction_tree<running_error<double> >;
+template class random_reduction_tree<running_error<float> >;
+template class random_reduction_tree<subnormal_counted<double> >;
+template class random_reduction_tree<scaled_double>;
 template class random_reduction_tree<boost::multiprecision::mpfr_float_50>;
 template class random_reduction_tree<boost::multiprecision::mpfr_float_100>;
 template class random_reduction_tree<boost::multiprecision::mpfr_float_500>;
@@ -5,27 +5,34 @@
 #include <algorithm>
 #include <cstdio>
 #include <iostream>
-#include <numeric>
 #include <string>
 #include <type_traits>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <boost/multiprecision/mpfr.hpp>
 
-#include "assoc.hxx"
+#include "prof.hxx"
 #include "rand.hxx"
-#include "util.hxx"
+#include "scaled_prod.hxx"
+#include "shuffle_assoc.hxx"
+#include "tree_shape.hxx"
+#include "vec_map.hxx"
 
 #define USAGE ("assoc_test <n> <iters> <distr> where\n"\
                "<n> is the number of leaves in the reduction tree\n"\
                "<iters> are the number of iterations to run\n"\
                "<distr> is the distribution to use. Choices are:\n"\
-               "\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n")
+               "\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n"\
+               "\tf64:<file> f32:<file> for the first <n> elements of a binary\n"\
+               "\tfile (vec_map.hxx), or all of them if <n> is 0\n"\
+               "With SHAPE_CACHE=<dir> the random trees are read from, or added to,\n"\
+               "\ta store in <dir> shared by all runs of the same <n> (tree_shape.hxx)\n")
 
 #define FLOAT_T double
 
 /* Note: it would be more robust to use ACCUMULATOR().operator()(a,b) instead
- * of a ACC_OP b, but this doesn't work for mpfr values */
+ * of a ACC_OP b, but this doesn't work for mpfr values. Products are not
+ * done in FLOAT_T, which they leave the range of, but in assoc_product. */
 /* #define ACCUMULATOR std::multiplies<FLOAT_T> */
 /* #define ACC_OP * */
 #define ACCUMULATOR std::plus<FLOAT_T>
@@ -36,16 +43,76 @@ const bool is_prod = std::is_same<std::multiplies<FLOAT_T>, ACCUMULATOR>::value;
 
 using namespace boost::multiprecision;
 
+static void print_scaled(long long len, const char *order, const std::string &dist,
+                         long long height, const scaled_double &x)
+{
+	/* Like MPFR, FP (hex) has the full value rather than the bits */
+	printf("%lld\t%s\t%s\t%lld\t%s\t%s\t%s\n", len, order, dist.c_str(), height,
+		scaled_dec(x).c_str(), scaled_hex(x).c_str(), scaled_hex(x).c_str());
+}
+
+/* The rows of main for products, in scaled_double (scaled_prod.hxx) so
+ * they neither underflow nor overflow, and against the exact product in
+ * place of MPFR */
+static void assoc_product(const FLOAT_T *A, long long len, long long iters,
+                          const std::string &dist, shape_cache_t *shapes)
+{
+	scaled_double exact, left, rand_acc;
+	shuffle_sums<scaled_double> shuf;
+	std::vector<scaled_double> As, scratch;
+	tree_shape_t shape;
+	long long i, j, height;
+
+	{
+		PROF_SCOPE("exact and left assoc");
+		exact = scaled_exact_prod(A, len);
+		left = scaled_left_prod(A, len);
+	}
+	printf("veclen\torder\tdistribution\theight\tFP (decimal)\tFP (%%a)\tFP (hex)\n");
+	print_scaled(len, "Exact", dist, len-1, exact);
+	print_scaled(len, "Left assoc", dist, len-1, left);
+
+	As.assign(A, A + len);
+	for (i = 0; i < iters; i++) {
+		j = 0;
+		{
+			PROF_SCOPE("tree shape");
+			shape = shape_cache_next(shapes);
+		}
+		{
+			PROF_SCOPE("random assoc");
+			rand_acc = shape_eval<scaled_double>(shape, [&]() { return As[j++]; }, false, &height);
+		}
+		print_scaled(len, "Random assoc", dist, height, rand_acc);
+		{
+			PROF_SCOPE("tree shape");
+			shape = shape_cache_next(shapes);
+		}
+		{
+			PROF_SCOPE("shuffle assoc");
+			shuf = shuffle_associate<scaled_double>(As.data(), len, false, shape,
+			                                        rand_stream(ASSOC_SEED, i), scratch);
+		}
+		print_scaled(len, "Shuffle l assoc", dist, height, shuf.left);
+		print_scaled(len, "Shuffle rand assoc", dist, shuf.height, shuf.tree);
+	}
+}
+
 int main (int argc, char* argv[])
 {
 	/* Initialize stuff */
 	int rc = 0;
-	long long len, i, iters, height;
-	FLOAT_T rng, def_acc, rand_acc, shuf_acc, sra_acc;
-	const FLOAT_T acc_init = is_sum ? 0. : (is_prod ? 1. : 0./0.);
+	long long len, i, j, iters, height;
+	FLOAT_T rng, def_acc, rand_acc;
 	FLOAT_T (*rand_flt)(); // Function to generate a random float
 	/* Chapp et al. use MPFR with 4096 bits which is 1233 digits */
 	mpfr_float_1000 mpfr_acc;
+	vec_kind_t kind;
+	vec_map_t map;
+	shuffle_sums<FLOAT_T> shuf;
+	shape_cache_t shapes;
+	std::string path, unused, msg;
+	const FLOAT_T *A; // The vector, generated or in the file
 	union udouble { // for type punning (to get bits of double)
 		double d;
 		unsigned long long u;
@@ -54,53 +121,91 @@ int main (int argc, char* argv[])
 		fprintf(stderr, USAGE);
 		return 1;
 	}
+	PROF_INIT("assoc_test");
 	len = atoll(argv[1]);
 	iters = atoll(argv[2]);
-	if (len <= 0 || iters <= 0) {
+	std::string dist = argv[3];
+	bool from_file = parse_vec_files(dist, &kind, &path, &unused) == 0;
+	if (len < 0 || (len == 0 && !from_file) || iters <= 0) {
 		rc = 1;
 		fprintf(stderr, USAGE);
 		return 1;
 	}
 	if (is_sum) {
-		def_acc = rand_acc = shuf_acc = 0.;
+		def_acc = rand_acc = 0.;
 		mpfr_acc = 0.;
 	} else if (is_prod) {
-		def_acc = rand_acc = shuf_acc = 1.;
+		def_acc = rand_acc = 1.;
 		mpfr_acc = 1.;
 	} else {
 		fprintf(stderr, "Must be sum or product:\n%s", USAGE);
 		return 1;
 	}
 	/* Select distribution for random floating point numbers */
-	std::string dist = argv[3];
 	FLOAT_T mag;
-	rc = parse_distr<FLOAT_T>(dist, &mag, &rand_flt);
-	if (rc != 0) {
+	if (!from_file && parse_distr<FLOAT_T>(dist, &mag, &rand_flt) != 0) {
 		fprintf(stderr, "Unrecognized distribution:\n%s", USAGE);
 		return 1;
 	}
 	
-	/* Store the random arrays */
+	/* Store the random arrays, and the shuffled one in buckets */
 	std::vector<FLOAT_T> def_a;
-	std::vector<FLOAT_T> a_shuf;
-	std::vector<mpfr_float_1000> a_mpfr;
-	def_a.reserve(len);
-	a_mpfr.reserve(len);
-	a_shuf.reserve(len);
+	std::vector<FLOAT_T> scratch;
 
-	/* Generate some random numbers */
 	set_seed(ASSOC_SEED, 0);
 	srand(ASSOC_SEED);
-	for (i = 0; i < len; i++) {
-		rng = rand_flt();
-
-		a_mpfr.push_back(rng);
-		mpfr_acc = mpfr_acc ACC_OP a_mpfr[i];
-
-		def_a.push_back(rng);
-		def_acc = def_acc ACC_OP rng;
+	if (from_file) {
+		/* float64 is summed in place; float32 is widened into def_a */
+		if (vec_map_open(path, kind, &map, msg) != 0) {
+			fprintf(stderr, "%s\n", msg.c_str());
+			return 1;
+		}
+		if (len == 0) {
+			len = map.n;
+		} else if (len > map.n) {
+			fprintf(stderr, "%s has %lld elements, fewer than %lld\n", path.c_str(), map.n, len);
+			return 1;
+		}
+		vec_map_advise(map, 0, len);
+		if (kind == VEC_F32) {
+			def_a.resize(len);
+		}
+		A = vec_map_doubles(map, 0, len, def_a.data());
+	} else {
+		/* Generate some random numbers */
+		PROF_SCOPE("generate");
+		def_a.reserve(len);
+		for (i = 0; i < len; i++) {
+			def_a.push_back(rand_flt());
+		}
+		A = def_a.data();
+	}
+	if (is_prod) {
+		shape_cache_open(shape_cache_dir(), len, ASSOC_SEED, &shapes, msg);
+		if (!msg.empty()) {
+			fprintf(stderr, "%s\n", msg.c_str());
+		}
+		assoc_product(A, len, iters, dist, &shapes);
+		shape_cache_close(&shapes);
+		if (from_file) {
+			vec_map_close(&map);
+		}
+		PROF_REPORT();
+		return rc;
+	}
+	{
+		PROF_SCOPE("mpfr and left assoc");
+		for (i = 0; i < len; i++) {
+			rng = A[i];
+			mpfr_acc = mpfr_acc ACC_OP mpfr_float_1000(rng);
+			def_acc = def_acc ACC_OP rng;
+		}
+	}
 
-		a_shuf.push_back(rng);
+	/* Trees come from rand() alone, so they are the same for every vector */
+	shape_cache_open(shape_cache_dir(), len, ASSOC_SEED, &shapes, msg);
+	if (!msg.empty()) {
+		fprintf(stderr, "%s\n", msg.c_str());
 	}
 
 	/* Print header then different summations */
@@ -117,22 +222,42 @@ int main (int argc, char* argv[])
 	printf("%lld\tLeft assoc\t%s\t%lld\t%.15f\t%a\t0x%llx\n", len, dist.c_str(), len-1, def_acc, def_acc, pv.u);
 
 	for (i = 0; i < iters; i++) {
+		tree_shape_t shape;
 		/* Random association, don't shuffle */
-		rand_acc = associative_accumulate_rand<FLOAT_T>(len, &def_a[0], is_sum, &height);
+		j = 0;
+		{
+			PROF_SCOPE("tree shape");
+			shape = shape_cache_next(&shapes);
+		}
+		{
+			PROF_SCOPE("random assoc");
+			rand_acc = shape_eval<FLOAT_T>(shape, [&]() { return A[j++]; }, is_sum, &height);
+		}
 		pv.d = rand_acc;
 		printf("%lld\tRandom assoc\t%s\t%lld\t%.15f\t%a\t0x%llx\n", len, dist.c_str(), height, rand_acc, rand_acc, pv.u);
 
-		/* Sum a random shuffle, accumulate left-associative. */
-		std::random_shuffle(a_shuf.begin(), a_shuf.end());
-		shuf_acc = std::accumulate(a_shuf.begin(), a_shuf.end(), acc_init, ACCUMULATOR());
-		pv.d = shuf_acc;
-		printf("%lld\tShuffle l assoc\t%s\t%lld\t%.15f\t%a\t0x%llx\n", len, dist.c_str(), height, shuf_acc, shuf_acc, pv.u);
+		/* A random shuffle, accumulated left-associative, and (MPI-sum)
+		 * randomly associated too, in one pass (shuffle_assoc.hxx) */
+		{
+			PROF_SCOPE("tree shape");
+			shape = shape_cache_next(&shapes);
+		}
+		{
+			PROF_SCOPE("shuffle assoc");
+			shuf = shuffle_associate<FLOAT_T>(A, len, is_sum, shape, rand_stream(ASSOC_SEED, i), scratch);
+		}
+		pv.d = shuf.left;
+		printf("%lld\tShuffle l assoc\t%s\t%lld\t%.15f\t%a\t0x%llx\n", len, dist.c_str(), height, shuf.left, shuf.left, pv.u);
 
-		/* MPI-sum: random shuffle _and_ random association */
-		sra_acc = associative_accumulate_rand<FLOAT_T>(len, &a_shuf[0], is_sum, &height);
-		pv.d = sra_acc;
-		printf("%lld\tShuffle rand assoc\t%s\t%lld\t%.15f\t%a\t0x%llx\n", len, dist.c_str(), height, sra_acc, sra_acc, pv.u);
+		height = shuf.height;
+		pv.d = shuf.tree;
+		printf("%lld\tShuffle rand assoc\t%s\t%lld\t%.15f\t%a\t0x%llx\n", len, dist.c_str(), height, shuf.tree, shuf.tree, pv.u);
+	}
+	shape_cache_close(&shapes);
+	if (from_file) {
+		vec_map_close(&map);
 	}
+	PROF_REPORT();
 	return rc;
 }
 #endif
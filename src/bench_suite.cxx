@@ -0,0 +1,386 @@
+/* Performance and bitwise regressions of the serial kernels.
+ *
+ * Every workload is seeded and its result must have the same bits on every
+ * run: the random numbers of rand.hxx, random_reduction_tree and the shapes
+ * of tree_shape.hxx at several n, shuffle_associate, the left-associative
+ * sum and the exact sum in MPFR. The tree shapes are drawn with rand(), so
+ * their bits are those of one C library (glibc for bench.bits).
+ *
+ * Each workload is run until it has seen BENCH_ELEMS elements and at least
+ * BENCH_REPS times, and the best ns per element of the timed part is kept.
+ * The peak resident memory of the whole workload, setup included, is
+ * VmHWM after resetting it through /proc/self/clear_refs; where that can't
+ * be reset it is the peak of the process so far (getrusage).
+ *
+ * The output can be kept as a baseline, and cut to its workload, n and
+ * result columns it is a baseline of the bits only, as bench.bits is.
+ * Given baselines, every workload has to match their results exactly and
+ * stay within BENCH_TOLERANCE (1.25) times the ns per element and peak
+ * memory of any that has them; the exit status is 1 if any does not.
+ * Timings belong to one machine, so only the bits are kept in the tree and
+ * make bench_baseline writes the timings of this one to bench.timing;
+ * without that, make bench checks the bits alone. The MPI ops are checked
+ * bitwise under SMPI by make bench with USE_MPI=1 (simgrid.mk).
+ */
+#ifndef BENCH_SUITE_CXX
+#define BENCH_SUITE_CXX
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <boost/multiprecision/mpfr.hpp>
+
+#include "assoc.hxx"
+#include "rand.hxx"
+#include "shuffle_assoc.hxx"
+#include "tree_shape.hxx"
+
+#define USAGE ("bench_suite [<baseline> ...] where\n"\
+               "<baseline> is the output of an earlier run to compare with, or its\n"\
+               "\tworkload, n and result columns to compare the results only.\n"\
+               "BENCH_TOLERANCE is how many times the ns per element and peak memory\n"\
+               "\tof a baseline a workload may take, 1.25 by default\n")
+
+/* Elements each workload sees at least, and runs it makes at least */
+#define BENCH_ELEMS (1LL << 22)
+#define BENCH_REPS 3
+#define BENCH_DISTR "runif[-1,1]"
+
+using namespace boost::multiprecision;
+
+/* One run of a workload over n elements. Returns its result as 64 bits and
+ * puts the seconds of the part being measured in *time. */
+typedef uint64_t (*workload_fn)(long long n, double *time);
+
+typedef struct workload {
+	const char *name;
+	long long n;
+	workload_fn run;
+} workload_t;
+
+typedef struct measured {
+	double ns;      // Per element
+	long long kb;   // Peak resident
+	uint64_t bits;
+	bool repeatable; // Every run gave the same bits
+	bool timed;      // ns and kb are known, for a baseline
+} measured_t;
+
+static double now()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t bits_of(double d)
+{
+	uint64_t u;
+	memcpy(&u, &d, sizeof(u));
+	return u;
+}
+
+/* splitmix64 finalizer of each word folded into the hash, as bits_hash of
+ * mpi_op */
+static uint64_t hash_bits(const double *a, long long n)
+{
+	uint64_t h = 0x9e3779b97f4a7c15ULL, u;
+	for (long long i = 0; i < n; i++) {
+		u = bits_of(a[i]);
+		h ^= u + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+		h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+		h ^= h >> 31;
+	}
+	return h;
+}
+
+/* The elements assoc_test sums for BENCH_DISTR */
+static void fill(std::vector<double> &a, long long n)
+{
+	double mag;
+	double (*rand_flt)();
+	parse_distr<double>(BENCH_DISTR, &mag, &rand_flt);
+	set_seed(ASSOC_SEED, 0);
+	a.resize(n);
+	for (long long i = 0; i < n; i++) {
+		a[i] = rand_flt();
+	}
+}
+
+static uint64_t rng_fill(long long n, double *time)
+{
+	std::vector<double> a;
+	double t = now();
+	fill(a, n);
+	*time = now() - t;
+	return hash_bits(a.data(), n);
+}
+
+static uint64_t left_assoc(long long n, double *time)
+{
+	std::vector<double> a;
+	double acc = 0.0, t;
+	fill(a, n);
+	t = now();
+	for (long long i = 0; i < n; i++) {
+		acc = acc + a[i];
+	}
+	*time = now() - t;
+	return bits_of(acc);
+}
+
+static uint64_t mpfr_exact(long long n, double *time)
+{
+	std::vector<double> a;
+	mpfr_float_1000 acc = 0;
+	double t;
+	fill(a, n);
+	t = now();
+	for (long long i = 0; i < n; i++) {
+		acc += a[i];
+	}
+	*time = now() - t;
+	return bits_of(acc.convert_to<double>());
+}
+
+/* Building the tree and summing it */
+static uint64_t tree_build(long long n, double *time)
+{
+	std::vector<double> a;
+	double acc, t;
+	fill(a, n);
+	t = now();
+	srand(ASSOC_SEED);
+	random_reduction_tree<double> tr(2, (long) n, a.data());
+	acc = tr.sum_tree();
+	*time = now() - t;
+	return bits_of(acc);
+}
+
+/* The same tree as tree_build, drawn as a shape and evaluated */
+static uint64_t tree_shape(long long n, double *time)
+{
+	std::vector<double> a;
+	std::vector<uint64_t> bits;
+	tree_shape_t s;
+	double acc, t;
+	long long j = 0, height;
+	fill(a, n);
+	t = now();
+	srand(ASSOC_SEED);
+	shape_draw(n, bits);
+	s.leaves = n;
+	s.bits = bits.data();
+	acc = shape_eval<double>(s, [&]() { return a[j++]; }, true, &height);
+	*time = now() - t;
+	return bits_of(acc);
+}
+
+static uint64_t shuffle_assoc(long long n, double *time)
+{
+	std::vector<double> a, scratch;
+	std::vector<uint64_t> bits;
+	shuffle_sums<double> r;
+	tree_shape_t s;
+	double t, both[2];
+	fill(a, n);
+	srand(ASSOC_SEED);
+	shape_draw(n, bits);
+	s.leaves = n;
+	s.bits = bits.data();
+	t = now();
+	r = shuffle_associate<double>(a.data(), n, true, s, rand_stream(ASSOC_SEED, 0), scratch);
+	*time = now() - t;
+	both[0] = r.left;
+	both[1] = r.tree;
+	return hash_bits(both, 2);
+}
+
+static const workload_t workloads[] = {
+	{"RNG fill",      1LL << 20, rng_fill},
+	{"Left assoc",    1LL << 20, left_assoc},
+	{"MPFR exact",    1LL << 16, mpfr_exact},
+	{"Tree build",    1000,      tree_build},
+	{"Tree build",    100000,    tree_build},
+	{"Tree build",    1000000,   tree_build},
+	{"Tree shape",    1000,      tree_shape},
+	{"Tree shape",    100000,    tree_shape},
+	{"Tree shape",    1000000,   tree_shape},
+	{"Shuffle assoc", 1000000,   shuffle_assoc},
+};
+
+/* Reset the peak resident memory to what is resident now. false if the
+ * kernel won't. */
+static bool peak_reset()
+{
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+	if (f == NULL) {
+		return false;
+	}
+	bool ok = fputs("5", f) >= 0;
+	return fclose(f) == 0 && ok;
+}
+
+/* Peak resident KiB since the last reset */
+static long long peak_kb(bool was_reset)
+{
+	struct rusage ru;
+	char line[256];
+	long long kb = -1;
+	FILE *f = was_reset ? fopen("/proc/self/status", "r") : NULL;
+	while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+		if (strncmp(line, "VmHWM:", 6) == 0) {
+			kb = atoll(line + 6);
+		}
+	}
+	if (f != NULL) {
+		fclose(f);
+	}
+	if (kb < 0 && getrusage(RUSAGE_SELF, &ru) == 0) {
+		kb = ru.ru_maxrss;
+	}
+	return kb;
+}
+
+static measured_t measure(const workload_t &w)
+{
+	measured_t m;
+	long long r, reps = std::max((long long) BENCH_REPS, BENCH_ELEMS / w.n);
+	double t, best = INFINITY;
+	uint64_t bits;
+	bool was_reset = peak_reset();
+
+	m.repeatable = true;
+	m.timed = true;
+	for (r = 0; r < reps; r++) {
+		bits = w.run(w.n, &t);
+		best = std::min(best, t);
+		m.repeatable = m.repeatable && (r == 0 || bits == m.bits);
+		m.bits = bits;
+	}
+	m.ns = best * 1e9 / w.n;
+	m.kb = peak_kb(was_reset);
+	return m;
+}
+
+typedef std::map<std::pair<std::string, long long>, measured_t> baseline_t;
+
+/* Rows of an earlier run, whole or with only workload, n and result, by
+ * workload and n. 0 on success. */
+static int read_baseline(const char *path, baseline_t &b)
+{
+	std::ifstream in(path);
+	std::string line, name;
+	std::vector<std::string> f;
+	measured_t m;
+	if (!in) {
+		return 1;
+	}
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream row(line);
+		f.clear();
+		while (std::getline(row, name, '\t')) {
+			f.push_back(name);
+		}
+		if (f.size() != 3 && f.size() != 6) {
+			return 1;
+		}
+		m.timed = f.size() == 6;
+		m.ns = m.timed ? atof(f[2].c_str()) : NAN;
+		m.kb = m.timed ? atoll(f[3].c_str()) : -1;
+		m.bits = strtoull(f[m.timed ? 4 : 2].c_str(), NULL, 16);
+		m.repeatable = true;
+		b[std::make_pair(f[0], atoll(f[1].c_str()))] = m;
+	}
+	return 0;
+}
+
+/* The status of m against the baselines, "ok" if it passes */
+static const char *compare(const measured_t &m, const std::string &name, long long n,
+                           const std::vector<baseline_t> &baselines, double tolerance)
+{
+	bool found = false;
+	for (size_t i = 0; i < baselines.size(); i++) {
+		auto b = baselines[i].find(std::make_pair(name, n));
+		if (b == baselines[i].end()) {
+			continue;
+		}
+		found = true;
+		if (m.bits != b->second.bits) {
+			return "WRONG BITS";
+		}
+		if (b->second.timed && m.ns > tolerance * b->second.ns) {
+			return "SLOWER";
+		}
+		if (b->second.timed && m.kb > tolerance * b->second.kb) {
+			return "MORE MEMORY";
+		}
+	}
+	return found ? "ok" : "not in baseline";
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<baseline_t> baselines;
+	const char *tol_env = getenv("BENCH_TOLERANCE");
+	double tolerance = tol_env == NULL ? 1.25 : atof(tol_env);
+	const char *status;
+	int failed = 0, i;
+	bool timed = false;
+	size_t w;
+
+	if (argc > 1 && std::string(argv[1]) == "-h") {
+		fprintf(stderr, USAGE);
+		return 1;
+	}
+	if (!(tolerance >= 1.0)) {
+		fprintf(stderr, "BENCH_TOLERANCE must be at least 1\n%s", USAGE);
+		return 1;
+	}
+	baselines.resize(argc - 1);
+	for (i = 1; i < argc; i++) {
+		if (read_baseline(argv[i], baselines[i - 1]) != 0) {
+			fprintf(stderr, "Could not read the baseline %s\n", argv[i]);
+			return 1;
+		}
+		for (auto b = baselines[i - 1].begin(); b != baselines[i - 1].end(); b++) {
+			timed = timed || b->second.timed;
+		}
+	}
+	if (argc > 1 && !timed) {
+		fprintf(stderr, "No baseline has timings, checking the results only\n");
+	}
+
+	printf("# workload\tn\tns per element\tpeak KiB\tresult\tstatus\n");
+	for (w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+		measured_t m = measure(workloads[w]);
+		if (!m.repeatable) {
+			status = "NOT REPEATABLE";
+		} else if (argc < 2) {
+			status = "NA";
+		} else {
+			status = compare(m, workloads[w].name, workloads[w].n, baselines, tolerance);
+		}
+		failed |= !m.repeatable || (argc > 1 && std::string(status) != "ok");
+		printf("%s\t%lld\t%.3f\t%lld\t0x%016llx\t%s\n", workloads[w].name, workloads[w].n,
+			m.ns, m.kb, (unsigned long long) m.bits, status);
+		fflush(stdout);
+	}
+	return failed;
+}
+
+#endif
@@ -0,0 +1,217 @@
+/* Error bounds for conjugate gradient, following the loop of cg in
+ * nekbone/custom/cg.f with the 1D Laplacian of ax1 and no preconditioner
+ * (z = r). One iteration is built once as a bound_dag, then run for every
+ * iteration with the ranges seen in a double-precision solve.
+ *
+ * Two bounds come out of it:
+ * - Forward bounds of rnorm, alpha and x against exact CG. Errors carried
+ *   from one iteration compound through A and the divisions, so these grow
+ *   by about ||A|| each iteration and are infinite after a few (5 for
+ *   n = 1000): worst-case forward error of CG is not bounded.
+ * - The residual gap f - A x - r, between the true residual and the one CG
+ *   recurs. The alpha and beta actually computed need not be exact for the
+ *   iteration to stay consistent, so only the rounding of this iteration's
+ *   matvec and updates, on the vectors it was given, adds to the gap:
+ *     |gap_k+1| <= |gap_k| + ||A|| |dx| + |alpha| |dw| + |dr|
+ *   with dx, dw and dr bounded by a second subgraph whose inputs are the
+ *   computed vectors, without error. The gap grows linearly, and
+ *   ||f - A x||_2 <= ||r||_2 + sqrt(n) |gap| bounds the true residual
+ *   for solves of any length. */
+#ifndef CG_BOUNDS_CXX
+#define CG_BOUNDS_CXX
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include "error_dag.hxx"
+#include "rand.hxx"
+
+#define USAGE ("cg_bounds <n> <iters> <distr> where\n"\
+               "<n> is the number of unknowns\n"\
+               "<iters> are the number of CG iterations\n"\
+               "<distr> is the distribution of the right-hand side. Choices are:\n"\
+               "\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n")
+
+#define FLOAT_T double
+
+typedef bound_dag<FLOAT_T> dag_t;
+
+/* w = A u, as ax1 in cg.f */
+static void ax1(std::vector<FLOAT_T> &w, const std::vector<FLOAT_T> &u)
+{
+	long long n = (long long) u.size();
+	FLOAT_T h2i = (FLOAT_T) (n + 1) * (n + 1);
+	for (long long i = 1; i < n - 1; i++) {
+		w[i] = h2i * (2 * u[i] - u[i-1] - u[i+1]);
+	}
+	w[0] = h2i * (2 * u[0] - u[1]);
+	w[n-1] = h2i * (2 * u[n-1] - u[n-2]);
+}
+
+/* Sum of a . b with all weights c = 1, as glsc3 */
+static FLOAT_T glsc3(const std::vector<FLOAT_T> &a, const std::vector<FLOAT_T> &b)
+{
+	FLOAT_T acc = 0.0;
+	for (size_t i = 0; i < a.size(); i++) {
+		acc += a[i] * b[i];
+	}
+	return acc;
+}
+
+static void observe_vec(dag_t &g, long k, dag_t::node_t v, const std::vector<FLOAT_T> &x)
+{
+	g.observe(k, v, *std::min_element(x.begin(), x.end()),
+	          *std::max_element(x.begin(), x.end()));
+}
+
+/* Rounded toward +inf, as in error_bounds */
+static double up(double r)
+{
+	return std::isnan(r) ? INFINITY : nextafter(r, INFINITY);
+}
+
+int main (int argc, char* argv[])
+{
+	int rc = 0;
+	long long n, i;
+	long iters, k;
+	FLOAT_T (*rand_flt)(); // Function to generate a random float
+	FLOAT_T mag = 0.0;
+
+	if (argc != 4) {
+		fprintf(stderr, USAGE);
+		return 1;
+	}
+	n = atoll(argv[1]);
+	iters = atol(argv[2]);
+	if (n < 2 || iters <= 0) {
+		fprintf(stderr, USAGE);
+		return 1;
+	}
+	std::string dist = argv[3];
+	rc = parse_distr<FLOAT_T>(dist, &mag, &rand_flt);
+	if (rc != 0) {
+		fprintf(stderr, "Unrecognized distribution:\n%s", USAGE);
+		return 1;
+	}
+
+	std::vector<FLOAT_T> f(n), x(n, 0.0), r(n), p(n, 0.0), w(n);
+	set_seed(ASSOC_SEED, 0);
+	srand(ASSOC_SEED);
+	for (i = 0; i < n; i++) {
+		f[i] = rand_flt();
+	}
+	r = f;
+	FLOAT_T h2i = (FLOAT_T) (n + 1) * (n + 1);
+
+	/* One CG iteration. Inputs are the values carried between iterations
+	 * and the weights c of glsc3 */
+	dag_t g;
+	dag_t::node_t c = g.input(n, 1.0, 1.0, 0.0);
+	dag_t::node_t x_in = g.input(n, 0.0, 0.0, 0.0);
+	dag_t::node_t r_in = g.input(n, *std::min_element(f.begin(), f.end()),
+	                             *std::max_element(f.begin(), f.end()), 0.0);
+	dag_t::node_t p_in = g.input(n, 0.0, 0.0, 0.0);
+	dag_t::node_t rtz1_in = g.input(1, 1.0, 1.0, 0.0);
+	dag_t::node_t rtz1 = g.dot(g.mul(r_in, c), r_in);        // glsc3(r,c,z)
+	dag_t::node_t beta = g.div(rtz1, rtz1_in);
+	dag_t::node_t pn = g.add(r_in, g.mul(beta, p_in));         // add2s1
+	dag_t::node_t wn = g.matvec(pn, 3, -h2i, 2 * h2i);         // ax
+	dag_t::node_t pap = g.dot(g.mul(wn, c), pn);               // glsc3(w,c,p)
+	dag_t::node_t alpha = g.div(rtz1, pap);
+	dag_t::node_t xn = g.add(x_in, g.mul(alpha, pn));          // add2s2
+	dag_t::node_t rn = g.sub(r_in, g.mul(alpha, wn));          // add2s2
+	dag_t::node_t rtr = g.dot(g.mul(rn, c), rn);               // glsc3(r,c,r)
+	dag_t::node_t rnorm = g.sqrt(rtr);
+	g.carry(xn, x_in);
+	g.carry(rn, r_in);
+	g.carry(pn, p_in);
+	g.carry(rtz1, rtz1_in);
+	g.watch(rnorm);
+	g.watch(alpha);
+	g.watch(xn);
+
+	/* The same updates on the computed p, alpha, w, x and r, as inputs
+	 * without error: the rounding of one iteration alone */
+	dag_t::node_t p_c = g.input(n, 0.0, 0.0, 0.0);
+	dag_t::node_t w_c = g.input(n, 0.0, 0.0, 0.0);
+	dag_t::node_t x_c = g.input(n, 0.0, 0.0, 0.0);
+	dag_t::node_t r_c = g.input(n, 0.0, 0.0, 0.0);
+	dag_t::node_t alpha_c = g.input(1, 0.0, 0.0, 0.0);
+	dag_t::node_t rn_c = g.input(n, 0.0, 0.0, 0.0);
+	dag_t::node_t dw = g.matvec(p_c, 3, -h2i, 2 * h2i);
+	dag_t::node_t dx = g.add(x_c, g.mul(alpha_c, p_c));
+	dag_t::node_t dr = g.sub(r_c, g.mul(alpha_c, w_c));
+	dag_t::node_t rtr_c = g.dot(g.mul(rn_c, c), rn_c);
+	dag_t::node_t drnorm = g.sqrt(rtr_c);
+	g.watch(dw);
+	g.watch(dx);
+	g.watch(dr);
+	g.watch(drnorm);
+	double a_norm = up(4 * h2i);
+
+	/* The solve itself, recording what each node held. The ranges are of
+	 * computed values, which enclose the exact ones to first order. */
+	std::vector<FLOAT_T> rnorms(iters), alphas(iters);
+	FLOAT_T rtz1_v = 1.0, rtz2_v, beta_v, pap_v, alpha_v, rtr_v;
+	for (k = 0; k < iters; k++) {
+		rtz2_v = rtz1_v;
+		rtz1_v = glsc3(r, r);
+		beta_v = k == 0 ? 0.0 : rtz1_v / rtz2_v;
+		for (i = 0; i < n; i++) {
+			p[i] = r[i] + beta_v * p[i];
+		}
+		ax1(w, p);
+		pap_v = glsc3(w, p);
+		alpha_v = rtz1_v / pap_v;
+		observe_vec(g, k, x_c, x);
+		observe_vec(g, k, r_c, r);
+		for (i = 0; i < n; i++) {
+			x[i] = x[i] + alpha_v * p[i];
+			r[i] = r[i] - alpha_v * w[i];
+		}
+		rtr_v = glsc3(r, r);
+		rnorms[k] = sqrt(rtr_v);
+		alphas[k] = alpha_v;
+
+		g.observe(k, rtz1, rtz1_v, rtz1_v);
+		g.observe(k, beta, beta_v, beta_v);
+		observe_vec(g, k, pn, p);
+		observe_vec(g, k, wn, w);
+		g.observe(k, pap, pap_v, pap_v);
+		g.observe(k, alpha, alpha_v, alpha_v);
+		observe_vec(g, k, xn, x);
+		observe_vec(g, k, rn, r);
+		g.observe(k, rtr, rtr_v, rtr_v);
+		g.observe(k, rnorm, rnorms[k], rnorms[k]);
+
+		observe_vec(g, k, p_c, p);
+		observe_vec(g, k, w_c, w);
+		g.observe(k, alpha_c, alpha_v, alpha_v);
+		observe_vec(g, k, rn_c, r);
+		g.observe(k, rtr_c, rtr_v, rtr_v);
+	}
+
+	g.run(iters);
+	printf("iter\tn\tdistribution\trnorm\trnorm error bound\talpha error bound\tx error bound"
+	       "\tresidual gap bound\ttrue residual bound\n");
+	double gap = 0.0, res_bound;
+	for (k = 0; k < iters; k++) {
+		gap = up(gap + up(up(a_norm * g.result(k, dx).err)
+		                  + up(up(fabs(alphas[k]) * g.result(k, dw).err)
+		                       + g.result(k, dr).err)));
+		res_bound = up(up(rnorms[k] + g.result(k, drnorm).err) + up(up(sqrt((double) n)) * gap));
+		printf("%ld\t%lld\t%s\t%.15e\t%.6e\t%.6e\t%.6e\t%.6e\t%.15e\n", k + 1, n, dist.c_str(),
+			rnorms[k], g.result(k, rnorm).err, g.result(k, alpha).err,
+			g.result(k, xn).err, gap, res_bound);
+	}
+	fprintf(stderr, "%lld node evaluations for %ld iterations\n",
+		g.evaluations(), g.iterations());
+	return 0;
+}
+
+#endif
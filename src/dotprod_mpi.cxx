@@ -18,14 +18,46 @@
  */
 #define USAGE (\
 	"mpirun -np <N> ./dotprod_mpi <len> <distr> <topology> <algorithm>\n"\
+	"mpirun -np <N> ./dotprod_mpi -f <jobs> <topology> <algorithm>\n"\
 	"<len> is size of the vector being reduced. mod(N,len) must be 0\n"\
 	"<distr> is the distribution to use. Choices are:\n"\
 	"\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n"\
+	"\tf64:<a file>[,<b file>] f32:<a file>[,<b file>] read the first <len>\n"\
+	"\telements of raw binary files (vec_map.hxx); b is all ones without one\n"\
+	"<jobs> is a file with one job per line, run in one launch:\n"\
+	"\t<len> <distr> <seed> <repetitions> <variant> [<batch> [<batches>]]\n"\
+	"\twhere repetition r uses seed + r and <variant> is one of\n"\
+	"\tall (every row, as without -f) reduce noncomm running ireduce iallreduce.\n"\
+	"\tireduce and iallreduce pipeline <batches> (default 100) batches of\n"\
+	"\t<batch> (default 16) nonblocking reductions, one per slice of a chunk\n"\
+	"\thybrid_fixed hybrid_omp hybrid_tree use OpenMP threads on each rank,\n"\
+	"\tcombined as described in hybrid.hxx, before MPI_Reduce\n"\
+	"\ttopo_linear topo_binomial reduce along the levels of <topology>\n"\
+	"\t(topo_reduce.hxx), timed and checked next to MPI_Reduce\n"\
+	"\ttrace reports the height of the trees MPI_Reduce really used with\n"\
+	"\ttraced commutative and noncommutative sums (reduce_trace.hxx); with\n"\
+	"\tREDUCE_TREES=<file> rank 0 also appends the trees and leaf depths\n"\
+	"\tsubnormal runs MPI_Reduce and the noncommutative sum as is and with\n"\
+	"\tsubnormals flushed to zero (subnormal.hxx), with time, error and the\n"\
+	"\toperations on all ranks that consumed or produced subnormals\n"\
+	"\tallreduce sums <batch> partials per rank, one per slice of a chunk,\n"\
+	"\twith one MPI_Allreduce and checks that every rank got the same bits,\n"\
+	"\twith the time of both and the error of the ranks that differ\n"\
+	"\ttuned sums <batch> partials per rank with the reduce and allreduce\n"\
+	"\treduce_tune.hxx picks, the fastest adding a predicted error under\n"\
+	"\tTUNE_BUDGET (default infinite) to the partials' own, of every library\n"\
+	"\twith TUNE_REPRODUCIBLE=1\n"\
+	"\tproduct multiplies the elements of a with MPI_PROD, and as mantissas\n"\
+	"\twith separate exponents (scaled_prod.hxx), against the exact product\n"\
+	"\tBlank lines and lines starting with # are skipped\n"\
 	"<topology> is a string for logging, best used with SimGrid\n"\
 	"<algorithm> is a string for logging, best used with SimGrid\n")
 
 #include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
 #include <mpi.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -33,10 +65,19 @@
 #include <boost/multiprecision/number.hpp>
 
 #include "assoc.hxx"
+#include "error_bounds.hxx"
 #include "error_semantics.hxx"
+#include "hybrid.hxx"
 #include "mpi_op.hxx"
+#include "prof.hxx"
 #include "rand.hxx"
+#include "reduce_trace.hxx"
+#include "reduce_tune.hxx"
+#include "scaled_prod.hxx"
+#include "subnormal.hxx"
+#include "topo_reduce.hxx"
 #include "util.hxx"
+#include "vec_map.hxx"
 
 #define FLOAT_T double
 using namespace boost::multiprecision;
@@ -51,199 +92,1295 @@ using namespace boost::math;
 
 const bool is_sum  = std::is_same<std::plus<FLOAT_T>, ACCUMULATOR>::value;
 const bool is_prod = std::is_same<std::multiplies<FLOAT_T>, ACCUMULATOR>::value;
+
+/* One configuration. Without -f the command line is a single job. */
+struct dot_job {
+	long long len;
+	std::string distr;
+	unsigned int seed;
+	long reps;
+	std::string variant;
+	long batch;    // Reductions per batch, for ireduce, iallreduce, allreduce and tuned
+	long batches;  // Number of pipelined batches
+};
+
+/* What all jobs of one launch share. Buffers grow to the longest job. */
+struct dot_ctx {
+	int taskid, numtasks;
+	std::string topo, algo;
+	long long cap;
+	FLOAT_T *abuf, *bbuf, *as, *bs, *rank_sum;
+	/* The current job's vectors: abuf and bbuf, or for a job reading
+	 * files the mappings, read-only, or abuf and bbuf filled from them */
+	FLOAT_T *a, *b;
+	bool from_file;
+	vec_map_t map_a, map_b;
+	running_error<FLOAT_T> *rank_run;
+	MPI_Op nc_sum_op, run_sum_op, trace_op, trace_nc_op, subn_op, subn_nc_op;
+	MPI_Op scaled_op, scaled_nc_op;
+	MPI_Datatype run_type, trace_type, scaled_type;
+	/* Two batches of local partials and results, for pipelining */
+	std::vector<FLOAT_T> nb_local, nb_out, nb_blocking;
+	std::vector<MPI_Request> nb_req;
+	/* Levels for the topo_ variants, made once if any job needs them */
+	bool has_hier;
+	topo_hier_t hier;
+};
+
 /* Fill in random vectors and do dot product according to MPI canonical ordering */
 FLOAT_T can_mpi_dot(int numtasks, long long len, FLOAT_T* as, FLOAT_T* bs, FLOAT_T (*rand_a)(), FLOAT_T (*rand_b)(), FLOAT_T *rank_sum);
 /* Left-associative dot product */
 FLOAT_T dot(long long len, FLOAT_T* a, FLOAT_T* b);
 /* Left-associative dot product with MPFR accumulator */
 mpfr_float_1000 mpfr_dot(FLOAT_T *a, FLOAT_T *b, long long len);
+/* Read a job file. 0 on success, 1 if it can't be read or a line is malformed */
+int read_jobs(const char *fn, std::vector<dot_job> &jobs, std::string &msg);
+/* 0 if job can run with ctx.numtasks ranks, else 1 with a reason in msg */
+int check_job(const dot_ctx &ctx, const dot_job &job, std::string &msg);
+/* Point ctx.a and ctx.b at the files of a job. 0 on success. */
+int map_job(dot_ctx &ctx, const dot_job &job, std::string &msg);
+/* All repetitions of a job. Rank 0 prints the rows as each one finishes. */
+void run_job(dot_ctx &ctx, const dot_job &job);
+void run_trial(dot_ctx &ctx, const dot_job &job, unsigned int seed);
+/* Batches of nonblocking reductions, compared to the same ones blocking */
+void run_nonblocking(dot_ctx &ctx, const dot_job &job, unsigned int seed);
+/* Threads on each rank, then MPI, with time and error of each level */
+void run_hybrid(dot_ctx &ctx, const dot_job &job, unsigned int seed);
+/* Reduction along the topology, with MPI_Reduce of the same partials */
+void run_topo(dot_ctx &ctx, const dot_job &job, unsigned int seed);
+/* MPI_Reduce with traced sums, to report the trees it used */
+void run_trace(dot_ctx &ctx, const dot_job &job, unsigned int seed);
+/* MPI_Reduce with and without flushing subnormals, counting them */
+void run_subnormal(dot_ctx &ctx, const dot_job &job, unsigned int seed);
+/* MPI_Allreduce, and whether all ranks hold the same result */
+void run_allreduce(dot_ctx &ctx, const dot_job &job, unsigned int seed);
+/* The reductions reduce_tune picks, and what it picked them from */
+void run_tuned(dot_ctx &ctx, const dot_job &job, unsigned int seed);
+/* Products of the elements of a, in double and with separate exponents */
+void run_product(dot_ctx &ctx, const dot_job &job, unsigned int seed);
 
 int main (int argc, char* argv[])
 {
-	int taskid, numtasks;
-	long i, chunk, rc=0;
-	long long len, height;
-	MPI_Op nc_sum_op;
-	std::string distr, topo, algo;
-	FLOAT_T *a, *b, *as, *bs, *rank_sum;
-	FLOAT_T localsum, nc_sum, par_sum, can_mpi_sum, rand_sum, serial_sum;
-	FLOAT_T starttime, endtime, ptime, ctime, stime, mpfrtime, randtreetime;
-	FLOAT_T (*rand_flt_a)(); // Function to generate a random float
-	FLOAT_T (*rand_flt_b)(); // Function to generate a random float
-	mpfr_float_1000 mpfr_acc;
-	mpfr_float_1000 error, result;
-	FLOAT_T magnitude = 0.0;
-	union udouble {
-		double d;
-		unsigned long u;
-	} pv;
+	int rc = 0;
+	size_t j;
+	dot_ctx ctx;
+	dot_job job;
+	std::vector<dot_job> jobs;
+	std::string msg;
 
 	/* MPI Initialization */
 	MPI_Init(&argc, &argv);
-	MPI_Comm_size(MPI_COMM_WORLD, &numtasks);
-	MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
+	MPI_Comm_size(MPI_COMM_WORLD, &ctx.numtasks);
+	MPI_Comm_rank(MPI_COMM_WORLD, &ctx.taskid);
+	PROF_INIT("rank " + std::to_string(ctx.taskid));
 
 	/* Parse arguments */
 	if (argc != 5) {
-		if (taskid == 0) {
+		if (ctx.taskid == 0) {
 			fprintf(stderr, "Expected 4 arguments, found %d\n", argc-1);
 			fprintf(stderr, USAGE);
 		}
 		rc = 1;
 		goto done;
 	}
-	len = atoll(argv[1]);
-	if (len <= 0 || len % numtasks != 0) {
-		if (taskid == 0) {
-			fprintf(stderr,
-					"Number of MPI ranks (%d) must divide vector size (%lld)\n%s",
-					numtasks, len, USAGE);
+	if (std::string(argv[1]) == "-f") {
+		/* Every rank reads the file so they agree on which jobs run */
+		if (read_jobs(argv[2], jobs, msg) != 0) {
+			if (ctx.taskid == 0) {
+				fprintf(stderr, "%s\n%s", msg.c_str(), USAGE);
+			}
+			rc = 1;
+			goto done;
+		}
+	} else {
+		job.len = atoll(argv[1]);
+		job.distr = argv[2];
+		job.seed = ASSOC_SEED;
+		job.reps = 1;
+		job.variant = "all";
+		job.batch = 0;
+		job.batches = 0;
+		jobs.push_back(job);
+	}
+	ctx.topo = argv[3];
+	ctx.algo = argv[4];
+
+	/* Create custom MPI Reduce that is just + but not commutative */
+	rc = MPI_Op_create((MPI_User_function *) noncommutative_sum, false, &ctx.nc_sum_op);
+	if (rc != 0) {
+		if (ctx.taskid == 0) {
+			fprintf(stderr, "Could not create MPI op noncommutative sum\n");
 		}
 		rc = 1;
 		goto done;
 	}
-	/* Select distribution for random floating point numbers */
-	distr = argv[2];
-	rc = parse_distr<FLOAT_T>(distr, &magnitude, &rand_flt_a)
-		|| parse_distr<FLOAT_T>(distr, &magnitude, &rand_flt_b);
+	/* And a sum that carries its own running error bound */
+	rc = running_error_type(&ctx.run_type)
+		|| MPI_Op_create((MPI_User_function *) running_error_sum, true, &ctx.run_sum_op);
 	if (rc != 0) {
-		if (taskid == 0) {
-			fprintf(stderr, "Unrecognized distribution:\n%s", USAGE);
+		if (ctx.taskid == 0) {
+			fprintf(stderr, "Could not create MPI op running error sum\n");
 		}
+		rc = 1;
 		goto done;
 	}
-	topo = argv[3];
-	algo = argv[4];
-
-	/* Create custom MPI Reduce that is just + but not commutative */
-	rc = MPI_Op_create((MPI_User_function *) noncommutative_sum, false, &nc_sum_op);
+	/* And sums that log how they were associated, either commutative or not */
+	rc = traced_value_type(&ctx.trace_type)
+		|| MPI_Op_create((MPI_User_function *) traced_sum, true, &ctx.trace_op)
+		|| MPI_Op_create((MPI_User_function *) traced_sum, false, &ctx.trace_nc_op);
 	if (rc != 0) {
-		if (taskid == 0) {
-			fprintf(stderr, "Could not create MPI op noncommutative sum\n");
+		if (ctx.taskid == 0) {
+			fprintf(stderr, "Could not create MPI op traced sum\n");
+		}
+		rc = 1;
+		goto done;
+	}
+	/* And sums that count the subnormals they touch */
+	rc = MPI_Op_create((MPI_User_function *) subnormal_counting_sum, true, &ctx.subn_op)
+		|| MPI_Op_create((MPI_User_function *) subnormal_counting_sum, false, &ctx.subn_nc_op);
+	if (rc != 0) {
+		if (ctx.taskid == 0) {
+			fprintf(stderr, "Could not create MPI op subnormal counting sum\n");
+		}
+		rc = 1;
+		goto done;
+	}
+	/* And products that neither overflow nor underflow */
+	rc = scaled_type(&ctx.scaled_type)
+		|| MPI_Op_create((MPI_User_function *) scaled_prod_op, true, &ctx.scaled_op)
+		|| MPI_Op_create((MPI_User_function *) scaled_prod_op, false, &ctx.scaled_nc_op);
+	if (rc != 0) {
+		if (ctx.taskid == 0) {
+			fprintf(stderr, "Could not create MPI op scaled product\n");
 		}
 		rc = 1;
 		goto done;
 	}
 
-	/* Assign storage for dot product vectors
-	 * We do extra here for simplicity and so rank 0 has enough room */
-	// XXX: Do not need to malloc as and bs on each MPI process, just on rank 0
-	// This is a bit trickier to make sure the rand is consistent though.
-	a  = (FLOAT_T*) malloc(len*sizeof(FLOAT_T));
-	b  = (FLOAT_T*) malloc(len*sizeof(FLOAT_T));
-	as = (FLOAT_T*) malloc(len*sizeof(FLOAT_T));
-	bs = (FLOAT_T*) malloc(len*sizeof(FLOAT_T));
-	rank_sum = (FLOAT_T*) malloc (numtasks*sizeof(FLOAT_T));
+	/* Levels of the topology, collective so only if some job uses them.
+	 * tuned tries reducing along them too. */
+	ctx.has_hier = false;
+	for (j = 0; j < jobs.size(); j++) {
+		ctx.has_hier = ctx.has_hier || jobs[j].variant.compare(0, 5, "topo_") == 0
+			|| jobs[j].variant == "tuned";
+	}
+	if (ctx.has_hier && topo_hier_create(topo_dir(), ctx.topo, MPI_COMM_WORLD, &ctx.hier, msg) != 0) {
+		if (ctx.taskid == 0) {
+			fprintf(stderr, "%s\n", msg.c_str());
+		}
+		rc = 1;
+		goto done;
+	}
+
+	/* Storage for the dot product vectors is allocated by the first job
+	 * and reused by the rest */
+	ctx.cap = 0;
+	ctx.abuf = ctx.bbuf = ctx.as = ctx.bs = NULL;
+	ctx.map_a.base = ctx.map_b.base = NULL;
+	ctx.rank_sum = (FLOAT_T*) malloc (ctx.numtasks*sizeof(FLOAT_T));
+	ctx.rank_run = new running_error<FLOAT_T>[ctx.numtasks];
+
+	if (ctx.taskid == 0) {
+		printf("numtasks\tveclen\ttopology\tdistribution\treduction algorithm\torder\theight\ttime\tFP (decimal)\tFP (%%a)\tFP (hex)\tseed\n");
+		fflush(stdout);
+	}
+	for (j = 0; j < jobs.size(); j++) {
+		if (check_job(ctx, jobs[j], msg) != 0) {
+			if (ctx.taskid == 0) {
+				fprintf(stderr, "Skipping job %zu: %s\n", j + 1, msg.c_str());
+			}
+			rc = 1;
+			continue;
+		}
+		run_job(ctx, jobs[j]);
+	}
+
+	free(ctx.abuf);
+	free(ctx.bbuf);
+	free(ctx.as);
+	free(ctx.bs);
+	free(ctx.rank_sum);
+	delete[] ctx.rank_run;
+	MPI_Op_free(&ctx.nc_sum_op);
+	MPI_Op_free(&ctx.run_sum_op);
+	MPI_Type_free(&ctx.run_type);
+	MPI_Op_free(&ctx.trace_op);
+	MPI_Op_free(&ctx.trace_nc_op);
+	MPI_Type_free(&ctx.trace_type);
+	MPI_Op_free(&ctx.subn_op);
+	MPI_Op_free(&ctx.subn_nc_op);
+	MPI_Op_free(&ctx.scaled_op);
+	MPI_Op_free(&ctx.scaled_nc_op);
+	MPI_Type_free(&ctx.scaled_type);
+	if (ctx.has_hier) {
+		topo_hier_free(&ctx.hier);
+	}
+
+done:
+	PROF_REPORT();
+	MPI_Finalize();
+	return rc;
+}
+
+int read_jobs(const char *fn, std::vector<dot_job> &jobs, std::string &msg)
+{
+	std::ifstream in(fn);
+	std::string line;
+	long lineno = 0;
+	dot_job job;
+
+	if (!in) {
+		msg = std::string("Could not open job file ") + fn;
+		return 1;
+	}
+	while (std::getline(in, line)) {
+		lineno++;
+		std::istringstream ss(line);
+		std::string first;
+		if (!(ss >> first) || first[0] == '#') {
+			continue;
+		}
+		ss.clear();
+		ss.str(line);
+		if (!(ss >> job.len >> job.distr >> job.seed >> job.reps >> job.variant)) {
+			msg = std::string(fn) + ":" + std::to_string(lineno)
+			      + ": expected <len> <distr> <seed> <repetitions> <variant>";
+			return 1;
+		}
+		if (!(ss >> job.batch)) {
+			job.batch = 16;
+		}
+		if (!(ss >> job.batches)) {
+			job.batches = 100;
+		}
+		jobs.push_back(job);
+	}
+	if (jobs.empty()) {
+		msg = std::string("No jobs in ") + fn;
+		return 1;
+	}
+	return 0;
+}
+
+int check_job(const dot_ctx &ctx, const dot_job &job, std::string &msg)
+{
+	double magnitude;
+	FLOAT_T (*rand_flt)();
+	vec_kind_t kind;
+	std::string fa, fb;
+
+	if (job.len <= 0 || job.len % ctx.numtasks != 0) {
+		msg = "Number of MPI ranks (" + std::to_string(ctx.numtasks)
+		      + ") must divide vector size (" + std::to_string(job.len) + ")";
+		return 1;
+	}
+	if (parse_vec_files(job.distr, &kind, &fa, &fb) == 0) {
+		if (vec_file_len(fa, kind) < job.len
+				|| (!fb.empty() && vec_file_len(fb, kind) < job.len)) {
+			msg = "Files of " + job.distr + " are missing or have fewer than "
+			      + std::to_string(job.len) + " elements";
+			return 1;
+		}
+	} else if (parse_distr<FLOAT_T>(job.distr, &magnitude, &rand_flt) != 0) {
+		msg = "Unrecognized distribution " + job.distr;
+		return 1;
+	}
+	if (job.reps <= 0) {
+		msg = "Repetitions must be positive";
+		return 1;
+	}
+	if (job.variant != "all" && job.variant != "reduce"
+			&& job.variant != "noncomm" && job.variant != "running"
+			&& job.variant != "ireduce" && job.variant != "iallreduce"
+			&& job.variant != "hybrid_fixed" && job.variant != "hybrid_omp"
+			&& job.variant != "hybrid_tree" && job.variant != "topo_linear"
+			&& job.variant != "topo_binomial" && job.variant != "trace"
+			&& job.variant != "subnormal" && job.variant != "allreduce"
+			&& job.variant != "tuned" && job.variant != "product") {
+		msg = "Unrecognized variant " + job.variant;
+		return 1;
+	}
+	if ((job.variant == "ireduce" || job.variant == "iallreduce" || job.variant == "allreduce"
+	     || job.variant == "tuned")
+			&& (job.batch <= 0 || job.batches <= 0
+			    || (job.len / ctx.numtasks) % job.batch != 0)) {
+		msg = "Batch size must divide the vector size per rank ("
+		      + std::to_string(job.len / ctx.numtasks) + ")";
+		return 1;
+	}
+	return 0;
+}
+
+int map_job(dot_ctx &ctx, const dot_job &job, std::string &msg)
+{
+	vec_kind_t kind;
+	std::string fa, fb;
+	long long i, chunk = job.len / ctx.numtasks;
+	/* Rank 0 checks results against the whole vectors; the others only
+	 * read their slice */
+	long long first = ctx.taskid == 0 ? 0 : chunk * ctx.taskid;
+	long long count = ctx.taskid == 0 ? job.len : chunk;
+
+	parse_vec_files(job.distr, &kind, &fa, &fb);
+	if (vec_map_open(fa, kind, &ctx.map_a, msg) != 0
+			|| (!fb.empty() && vec_map_open(fb, kind, &ctx.map_b, msg) != 0)) {
+		return 1;
+	}
+	vec_map_advise(ctx.map_a, first, count);
+	ctx.a = (FLOAT_T *) vec_map_doubles(ctx.map_a, first, count, ctx.abuf + first) - first;
+	if (fb.empty()) {
+		for (i = first; i < first + count; i++) {
+			ctx.bbuf[i] = 1.0;
+		}
+		ctx.b = ctx.bbuf;
+	} else {
+		vec_map_advise(ctx.map_b, first, count);
+		ctx.b = (FLOAT_T *) vec_map_doubles(ctx.map_b, first, count, ctx.bbuf + first) - first;
+	}
+	return 0;
+}
 
-	/* Initialize dot product vectors */
+void run_job(dot_ctx &ctx, const dot_job &job)
+{
+	long r;
+	vec_kind_t kind;
+	std::string fa, fb, msg;
+
+	ctx.from_file = parse_vec_files(job.distr, &kind, &fa, &fb) == 0;
+	/* A float64 file with both vectors needs no buffers at all. Pages of
+	 * the others are only touched where they are filled. */
+	if (job.len > ctx.cap && (!ctx.from_file || kind == VEC_F32 || fb.empty())) {
+		ctx.abuf = (FLOAT_T*) realloc(ctx.abuf, job.len*sizeof(FLOAT_T));
+		ctx.bbuf = (FLOAT_T*) realloc(ctx.bbuf, job.len*sizeof(FLOAT_T));
+		ctx.as   = (FLOAT_T*) realloc(ctx.as,   job.len*sizeof(FLOAT_T));
+		ctx.bs   = (FLOAT_T*) realloc(ctx.bs,   job.len*sizeof(FLOAT_T));
+		ctx.cap = job.len;
+	}
+	ctx.a = ctx.abuf;
+	ctx.b = ctx.bbuf;
+	if (ctx.from_file && map_job(ctx, job, msg) != 0) {
+		/* check_job saw the files, so this is not something to skip */
+		fprintf(stderr, "Rank %d: %s\n", ctx.taskid, msg.c_str());
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	for (r = 0; r < job.reps; r++) {
+		run_trial(ctx, job, job.seed + (unsigned int) r);
+		if (ctx.taskid == 0) {
+			fflush(stdout);
+		}
+	}
+	if (ctx.from_file) {
+		vec_map_close(&ctx.map_a);
+		vec_map_close(&ctx.map_b);
+	}
+}
+
+void run_trial(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks;
+	long i, chunk;
+	long long len = job.len, height;
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	bool all = job.variant == "all";
+	FLOAT_T *a = ctx.a, *b = ctx.b, *as = ctx.as, *bs = ctx.bs, *rank_sum = ctx.rank_sum;
+	FLOAT_T localsum, nc_sum, par_sum, can_mpi_sum, rand_sum, serial_sum;
+	running_error<FLOAT_T> local_run, run_sum, rand_run;
+	FLOAT_T starttime, endtime, dottime, ptime, nctime, runtime, ctime, stime, mpfrtime, randtreetime;
+	FLOAT_T (*rand_flt_a)(); // Function to generate a random float
+	FLOAT_T (*rand_flt_b)(); // Function to generate a random float
+	mpfr_float_1000 mpfr_acc;
+	mpfr_float_1000 result;
+	vec_bound<FLOAT_T> a_bound, b_bound;
+	scal_bound<FLOAT_T> error;
+	FLOAT_T magnitude = 0.0;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
+
+	/* Select distribution for random floating point numbers. Vectors
+	 * from files are already in a and b, and are their own as and bs. */
+	rand_flt_a = rand_flt_b = NULL;
+	if (ctx.from_file) {
+		as = a;
+		bs = b;
+	} else {
+		parse_distr<FLOAT_T>(job.distr, &magnitude, &rand_flt_a);
+		parse_distr<FLOAT_T>(job.distr, &magnitude, &rand_flt_b);
+	}
+
+	/* Initialize dot product vectors. We do extra here for simplicity and
+	 * so rank 0 has enough room */
+	// XXX: Do not need to fill as and bs on each MPI process, just on rank 0
+	// This is a bit trickier to make sure the rand is consistent though.
 	chunk = len/numtasks;
-	set_seed(ASSOC_SEED, 0);
-	srand(ASSOC_SEED);
-	for (i = 0; i < len; i++) {
-		a[i] = rand_flt_a();
-		b[i] = rand_flt_b();
+	set_seed(seed, 0);
+	srand(seed);
+	{
+		PROF_SCOPE("generate");
+		for (i = 0; i < len && !ctx.from_file; i++) {
+			a[i] = rand_flt_a();
+			b[i] = rand_flt_b();
+		}
+	}
+	if (job.variant == "ireduce" || job.variant == "iallreduce") {
+		run_nonblocking(ctx, job, seed);
+		return;
+	}
+	if (job.variant.compare(0, 7, "hybrid_") == 0) {
+		run_hybrid(ctx, job, seed);
+		return;
+	}
+	if (job.variant.compare(0, 5, "topo_") == 0) {
+		run_topo(ctx, job, seed);
+		return;
+	}
+	if (job.variant == "trace") {
+		run_trace(ctx, job, seed);
+		return;
+	}
+	if (job.variant == "subnormal") {
+		run_subnormal(ctx, job, seed);
+		return;
+	}
+	if (job.variant == "allreduce") {
+		run_allreduce(ctx, job, seed);
+		return;
+	}
+	if (job.variant == "tuned") {
+		run_tuned(ctx, job, seed);
+		return;
+	}
+	if (job.variant == "product") {
+		run_product(ctx, job, seed);
+		return;
 	}
 
 	/* Perform the dot product in parallel */
 	starttime = MPI_Wtime();
-	localsum = 0.0;
-	for (i = chunk*taskid; i < chunk*taskid + chunk; i++) {
-		localsum += a[i] * b[i];
+	{
+		PROF_SCOPE("local dot");
+		localsum = 0.0;
+		for (i = chunk*taskid; i < chunk*taskid + chunk; i++) {
+			localsum += a[i] * b[i];
+		}
 	}
+	dottime = MPI_Wtime() - starttime;
 
 	/* After the dot product, perform a summation of results on each node */
-	MPI_Reduce(&localsum, &par_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	{
+		PROF_SCOPE("reduce");
+		if (job.variant == "noncomm") {
+			MPI_Reduce(&localsum, &nc_sum, 1, MPI_DOUBLE, ctx.nc_sum_op, 0, MPI_COMM_WORLD);
+		} else if (job.variant != "running") {
+			MPI_Reduce(&localsum, &par_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+		}
+	}
 	endtime = MPI_Wtime();
-	MPI_Reduce(&localsum, &nc_sum, 1, MPI_DOUBLE, nc_sum_op, 0, MPI_COMM_WORLD);
 	ptime = endtime - starttime;
+	if (all) {
+		/* Timed as the local dot product plus its own reduction */
+		PROF_SCOPE("noncomm reduce");
+		starttime = MPI_Wtime();
+		MPI_Reduce(&localsum, &nc_sum, 1, MPI_DOUBLE, ctx.nc_sum_op, 0, MPI_COMM_WORLD);
+		endtime = MPI_Wtime();
+		nctime = dottime + (endtime - starttime);
+	}
+	if (all || job.variant == "running") {
+		PROF_SCOPE("running reduce");
+		starttime = MPI_Wtime();
+		local_run = running_dot(a + chunk*taskid, b + chunk*taskid, chunk);
+		MPI_Reduce(&local_run, &run_sum, 1, ctx.run_type, ctx.run_sum_op, 0, MPI_COMM_WORLD);
+		endtime = MPI_Wtime();
+		runtime = endtime - starttime;
+	}
+	if (all) {
+		PROF_SCOPE("gather");
+		MPI_Gather(&local_run, 1, ctx.run_type, ctx.rank_run, 1, ctx.run_type, 0, MPI_COMM_WORLD);
+	}
+
+	if (taskid == 0 && !all) {
+		if (job.variant == "reduce") {
+			pv.d = par_sum;
+			printf("%d\t%lld\t%s\t%s\t%s\tMPI Reduce\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+				numtasks, len, topo, distr, algo, (long long) ceil(log2(numtasks)), ptime, par_sum, par_sum, pv.u, seed);
+		} else if (job.variant == "noncomm") {
+			pv.d = nc_sum;
+			printf("%d\t%lld\t%s\t%s\t%s\tMPI noncomm sum\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+				numtasks, len, topo, distr, algo, (long long) numtasks-1, ptime, nc_sum, nc_sum, pv.u, seed);
+		} else {
+			pv.d = run_sum.val;
+			printf("%d\t%lld\t%s\t%s\t%s\tMPI running sum\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+				numtasks, len, topo, distr, algo, (long long) ceil(log2(numtasks)), runtime, run_sum.val, run_sum.val, pv.u, seed);
+			printf("%d\t%lld\t%s\t%s\t%s\tMPI running error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+				numtasks, len, topo, distr, algo, (long long) ceil(log2(numtasks)), nan(""), run_sum.err, run_sum.err, run_sum.err, seed);
+		}
+		return;
+	}
 
 	/* Now, task 0 does all the work to check. The canonical ordering * is increasing taskid */
-	set_seed(ASSOC_SEED, 0);
-	srand(ASSOC_SEED);
+	set_seed(seed, 0);
+	srand(seed);
 	if (taskid == 0) {
 		// Do the canonical MPI dot product summation
-		starttime = MPI_Wtime();
-		can_mpi_sum = can_mpi_dot(numtasks, len, as, bs, rand_flt_a, rand_flt_b, rank_sum);
-		endtime = MPI_Wtime();
-		ctime = endtime - starttime;
+		{
+			PROF_SCOPE("canonical");
+			starttime = MPI_Wtime();
+			can_mpi_sum = can_mpi_dot(numtasks, len, as, bs, rand_flt_a, rand_flt_b, rank_sum);
+			endtime = MPI_Wtime();
+			ctime = endtime - starttime;
+		}
 
 		// Do the serial sum
-		starttime = MPI_Wtime();
-		serial_sum = dot(len, a, b);
-		endtime = MPI_Wtime();
-		stime = endtime - starttime;
+		{
+			PROF_SCOPE("serial");
+			starttime = MPI_Wtime();
+			serial_sum = dot(len, a, b);
+			endtime = MPI_Wtime();
+			stime = endtime - starttime;
+		}
 
 		// Generate a random dot product on the MPI ranks
-		starttime = MPI_Wtime();
-		rand_sum = associative_accumulate_rand<FLOAT_T>(numtasks, rank_sum, is_sum, &height);
-		endtime = MPI_Wtime();
-		randtreetime = endtime - starttime;
+		{
+			PROF_SCOPE("random tree");
+			starttime = MPI_Wtime();
+			rand_sum = associative_accumulate_rand<FLOAT_T>(numtasks, rank_sum, is_sum, &height);
+			endtime = MPI_Wtime();
+			randtreetime = endtime - starttime;
+			// Same tree again, with running error bounds
+			srand(seed);
+			rand_run = associative_accumulate_rand<running_error<FLOAT_T> >(
+				numtasks, ctx.rank_run, is_sum, &height);
+		}
 
 		// MPFR dot product
-		starttime = MPI_Wtime();
-		mpfr_acc = mpfr_dot(as, bs, len);
-		endtime = MPI_Wtime();
-		mpfrtime = endtime - starttime;
+		{
+			PROF_SCOPE("mpfr");
+			starttime = MPI_Wtime();
+			mpfr_acc = mpfr_dot(as, bs, len);
+			endtime = MPI_Wtime();
+			mpfrtime = endtime - starttime;
+		}
 
 		// Error analysis
-		error = dot_e(magnitude, len, 0.0);
+		{
+			PROF_SCOPE("bounds");
+			a_bound = bound_of(a, len, 0.0);
+			b_bound = bound_of(b, len, 0.0);
+			error = dot_bound(a_bound, b_bound);
+#ifdef MPFR_BOUNDS
+			// Check the fast bound against the MPFR one it should never understate
+			result = dot_e(Vec_E<FLOAT_T>(len, a_bound.lb, a_bound.ub, 0.0),
+			               Vec_E<FLOAT_T>(len, b_bound.lb, b_bound.ub, 0.0)).error_ub();
+			if (error.err < result) {
+				fprintf(stderr, "Fast error bound %a is below MPFR bound %a\n",
+					error.err, result.convert_to<double>());
+			}
+#endif
+		}
 
-		// TODO: Figure out the height of MPI Reduce and MPI noncommutative sum, and canonical MPI sum
+		// The heights of MPI Reduce and MPI noncomm sum are guesses; the trace variant measures them
 		// TODO: Add in timings for MPFR and serial summations.
 
-		// Print header then different dot products
-		printf("numtasks\tveclen\ttopology\tdistribution\treduction algorithm\torder\theight\ttime\tFP (decimal)\tFP (%%a)\tFP (hex)\n");
+		// Print different dot products
+		PROF_SCOPE("print");
 		pv.d = serial_sum;
-		printf("%d\t%lld\t%s\t%s\t%s\tLeft assoc\t%lld\t%f\t%.15f\t%a\t0x%lx\n",
-			numtasks, len, topo.c_str(), distr.c_str(), algo.c_str(), len-1, stime, serial_sum, serial_sum, pv.u);
+		printf("%d\t%lld\t%s\t%s\t%s\tLeft assoc\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+			numtasks, len, topo, distr, algo, len-1, stime, serial_sum, serial_sum, pv.u, seed);
 		pv.d = rand_sum;
-		printf("%d\t%lld\t%s\t%s\t%s\tRandom assoc\t%lld\t%f\t%.15f\t%a\t0x%lx\n",
-			numtasks, len, topo.c_str(), distr.c_str(), algo.c_str(), height, randtreetime, rand_sum, rand_sum, pv.u);
+		printf("%d\t%lld\t%s\t%s\t%s\tRandom assoc\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+			numtasks, len, topo, distr, algo, height, randtreetime, rand_sum, rand_sum, pv.u, seed);
 		pv.d = par_sum;
-		printf("%d\t%lld\t%s\t%s\t%s\tMPI Reduce\t%lld\t%f\t%.15f\t%a\t0x%lx\n",
-			numtasks, len, topo.c_str(), distr.c_str(), algo.c_str(), (long long) ceil(log2(numtasks)), ptime, par_sum, par_sum, pv.u);
+		printf("%d\t%lld\t%s\t%s\t%s\tMPI Reduce\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+			numtasks, len, topo, distr, algo, (long long) ceil(log2(numtasks)), ptime, par_sum, par_sum, pv.u, seed);
 		pv.d = nc_sum;
-		printf("%d\t%lld\t%s\t%s\t%s\tMPI noncomm sum\t%lld\t%f\t%.15f\t%a\t0x%lx\n",
-			numtasks, len, topo.c_str(), distr.c_str(), algo.c_str(), (long long) numtasks-1, ptime, nc_sum, nc_sum, pv.u);
+		printf("%d\t%lld\t%s\t%s\t%s\tMPI noncomm sum\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+			numtasks, len, topo, distr, algo, (long long) numtasks-1, nctime, nc_sum, nc_sum, pv.u, seed);
 		pv.d = can_mpi_sum;
-		printf("%d\t%lld\t%s\t%s\t%s\tCanonical MPI\t%lld\t%f\t%.15f\t%a\t0x%lx\n",
-			numtasks, len, topo.c_str(), distr.c_str(), algo.c_str(), (long long) numtasks-1, ctime, can_mpi_sum, can_mpi_sum, pv.u);
-		mpfr_printf("%d\t%lld\t%s\t%s\t%s\tMPFR(%d) left assoc\t%lld\t%f\t%.20RNf\t%.20RNe\t%RNa\n",
-			numtasks, len, topo.c_str(), distr.c_str(), algo.c_str(),
+		printf("%d\t%lld\t%s\t%s\t%s\tCanonical MPI\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+			numtasks, len, topo, distr, algo, (long long) numtasks-1, ctime, can_mpi_sum, can_mpi_sum, pv.u, seed);
+		mpfr_printf("%d\t%lld\t%s\t%s\t%s\tMPFR(%d) left assoc\t%lld\t%f\t%.20RNf\t%.20RNe\t%RNa\t%u\n",
+			numtasks, len, topo, distr, algo,
 			std::numeric_limits<mpfr_float_1000>::digits, // Precision of MPFR
-			len - 1, mpfrtime, mpfr_acc, mpfr_acc, mpfr_acc);
-		mpfr_printf("%d\t%lld\t%s\t%s\t%s\tPredicted error\t%lld\t%f\t%.20RNf\t%.20RNe\t%RNa\n",
-			numtasks, len, topo.c_str(), distr.c_str(), algo.c_str(),
-			len-1, nan(""), error, error, error);
+			len - 1, mpfrtime, mpfr_acc, mpfr_acc, mpfr_acc, seed);
+		printf("%d\t%lld\t%s\t%s\t%s\tPredicted error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+			numtasks, len, topo, distr, algo,
+			len-1, nan(""), error.err, error.err, error.err, seed);
+		printf("%d\t%lld\t%s\t%s\t%s\tMPI running error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+			numtasks, len, topo, distr, algo,
+			(long long) ceil(log2(numtasks)), runtime, run_sum.err, run_sum.err, run_sum.err, seed);
+		printf("%d\t%lld\t%s\t%s\t%s\tRandom assoc running error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+			numtasks, len, topo, distr, algo,
+			height, nan(""), rand_run.err, rand_run.err, rand_run.err, seed);
 		result = abs(serial_sum - mpfr_acc);
-		mpfr_printf("%d\t%lld\t%s\t%s\t%s\tLeft assoc error\t%lld\t%f\t%.20RNf\t%.20RNe\t%RNa\n",
-			numtasks, len, topo.c_str(), distr.c_str(), algo.c_str(),
-			len - 1, nan(""), result, result, result);
+		mpfr_printf("%d\t%lld\t%s\t%s\t%s\tLeft assoc error\t%lld\t%f\t%.20RNf\t%.20RNe\t%RNa\t%u\n",
+			numtasks, len, topo, distr, algo,
+			len - 1, nan(""), result, result, result, seed);
 	}
+}
 
-	free(a);
-	free(b);
-	free(as);
-	free(bs);
-	free(rank_sum);
-	MPI_Op_free(&nc_sum_op);
+void run_nonblocking(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks, flag;
+	bool all = job.variant == "iallreduce";
+	long k, r, K = job.batch, R = job.batches;
+	long long i, chunk = job.len / numtasks, slice = chunk / K, ndiff;
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	const char *nb_name = all ? "MPI Iallreduce" : "MPI Ireduce";
+	const char *b_name = all ? "MPI Allreduce" : "MPI Reduce";
+	FLOAT_T *a = ctx.a + chunk*taskid, *b = ctx.b + chunk*taskid;
+	FLOAT_T *cur, *res, *next;
+	FLOAT_T starttime, t, nbtime, btime, nb_err, b_err, maxdiff;
+	long long height = (long long) ceil(log2(numtasks));
+	mpfr_float_1000 exact;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
 
-done:
-	MPI_Finalize();
-	return rc;
+	ctx.nb_local.resize(2*K);
+	ctx.nb_out.resize(2*K);
+	ctx.nb_blocking.resize(K);
+	ctx.nb_req.resize(K);
+
+	/* Blocking: the same reductions, one after the other */
+	MPI_Barrier(MPI_COMM_WORLD);
+	starttime = MPI_Wtime();
+	for (r = 0; r < R; r++) {
+		for (k = 0; k < K; k++) {
+			ctx.nb_local[k] = dot(slice, a + k*slice, b + k*slice);
+			if (all) {
+				MPI_Allreduce(&ctx.nb_local[k], &ctx.nb_blocking[k], 1, MPI_DOUBLE,
+				              MPI_SUM, MPI_COMM_WORLD);
+			} else {
+				MPI_Reduce(&ctx.nb_local[k], &ctx.nb_blocking[k], 1, MPI_DOUBLE,
+				           MPI_SUM, 0, MPI_COMM_WORLD);
+			}
+		}
+	}
+	t = MPI_Wtime() - starttime;
+	MPI_Reduce(&t, &btime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+	/* Pipelined: batch r is reduced while batch r+1 is computed. Testing
+	 * the requests between slices lets MPIs without a progress thread move
+	 * the reductions along. */
+	MPI_Barrier(MPI_COMM_WORLD);
+	starttime = MPI_Wtime();
+	for (k = 0; k < K; k++) {
+		ctx.nb_local[k] = dot(slice, a + k*slice, b + k*slice);
+	}
+	for (r = 0; r < R; r++) {
+		cur = &ctx.nb_local[(r % 2) * K];
+		res = &ctx.nb_out[(r % 2) * K];
+		next = &ctx.nb_local[((r + 1) % 2) * K];
+		for (k = 0; k < K; k++) {
+			if (all) {
+				MPI_Iallreduce(&cur[k], &res[k], 1, MPI_DOUBLE, MPI_SUM,
+				               MPI_COMM_WORLD, &ctx.nb_req[k]);
+			} else {
+				MPI_Ireduce(&cur[k], &res[k], 1, MPI_DOUBLE, MPI_SUM, 0,
+				            MPI_COMM_WORLD, &ctx.nb_req[k]);
+			}
+		}
+		if (r + 1 < R) {
+			for (k = 0; k < K; k++) {
+				next[k] = dot(slice, a + k*slice, b + k*slice);
+				MPI_Testall(K, ctx.nb_req.data(), &flag, MPI_STATUSES_IGNORE);
+			}
+		}
+		MPI_Waitall(K, ctx.nb_req.data(), MPI_STATUSES_IGNORE);
+	}
+	t = MPI_Wtime() - starttime;
+	MPI_Reduce(&t, &nbtime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+	if (taskid != 0) {
+		return;
+	}
+	/* Compare the last batch with the blocking results and with MPFR */
+	res = &ctx.nb_out[((R - 1) % 2) * K];
+	ndiff = 0;
+	maxdiff = nb_err = b_err = 0.0;
+	for (k = 0; k < K; k++) {
+		if (res[k] != ctx.nb_blocking[k]) {
+			ndiff++;
+			maxdiff = std::max(maxdiff, fabs(res[k] - ctx.nb_blocking[k]));
+		}
+		exact = 0.0;
+		for (int p = 0; p < numtasks; p++) {
+			for (i = p*chunk + k*slice; i < p*chunk + (k+1)*slice; i++) {
+				exact += mpfr_float_1000(ctx.a[i]) * ctx.b[i];
+			}
+		}
+		nb_err = std::max(nb_err, abs(res[k] - exact).convert_to<FLOAT_T>());
+		b_err = std::max(b_err, abs(ctx.nb_blocking[k] - exact).convert_to<FLOAT_T>());
+	}
+	pv.d = res[0];
+	printf("%d\t%lld\t%s\t%s\t%s\t%s\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+		numtasks, job.len, topo, distr, algo, nb_name, height, nbtime, res[0], res[0], pv.u, seed);
+	pv.d = ctx.nb_blocking[0];
+	printf("%d\t%lld\t%s\t%s\t%s\t%s\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+		numtasks, job.len, topo, distr, algo, b_name, height, btime,
+		ctx.nb_blocking[0], ctx.nb_blocking[0], pv.u, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s reductions/s\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, nb_name, height, nbtime,
+		K*R / nbtime, K*R / nbtime, K*R / nbtime, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s reductions/s\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, b_name, height, btime,
+		K*R / btime, K*R / btime, K*R / btime, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s differs from blocking\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, nb_name, height, nan(""),
+		(double) ndiff, (double) ndiff, (double) ndiff, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s max difference\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, nb_name, height, nan(""),
+		maxdiff, maxdiff, maxdiff, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s max error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, nb_name, height, nan(""),
+		nb_err, nb_err, nb_err, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s max error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, b_name, height, nan(""),
+		b_err, b_err, b_err, seed);
+}
+
+void run_hybrid(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks, p;
+	long long i, chunk = job.len / numtasks;
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	std::string name = "Hybrid " + job.variant.substr(7);
+	intra_tree_t how;
+	intra_result_t node;
+	FLOAT_T starttime, t, ctime, itime, rtime, final_sum;
+	FLOAT_T intra_err, inter_err, total_err;
+	long long height = (long long) ceil(log2(numtasks));
+	mpfr_float_1000 exact, exact_rank, node_total;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
+
+	parse_intra(job.variant.substr(7), &how);
+	MPI_Barrier(MPI_COMM_WORLD);
+	node = intra_dot(ctx.a + chunk*taskid, ctx.b + chunk*taskid, chunk, how);
+	MPI_Barrier(MPI_COMM_WORLD);
+	starttime = MPI_Wtime();
+	MPI_Reduce(&node.sum, &final_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	t = MPI_Wtime() - starttime;
+	MPI_Reduce(&t, &rtime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	MPI_Reduce(&node.compute_time, &ctime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	MPI_Reduce(&node.combine_time, &itime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	MPI_Gather(&node.sum, 1, MPI_DOUBLE, ctx.rank_sum, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	if (taskid != 0) {
+		return;
+	}
+
+	/* Intra-node error is the worst over ranks of the node sum against its
+	 * exact chunk; inter-node error is of MPI_Reduce against the exact sum
+	 * of the node sums it was given */
+	intra_err = 0.0;
+	exact = 0.0;
+	node_total = 0.0;
+	for (p = 0; p < numtasks; p++) {
+		exact_rank = 0.0;
+		for (i = p*chunk; i < (p+1)*chunk; i++) {
+			exact_rank += mpfr_float_1000(ctx.a[i]) * ctx.b[i];
+		}
+		intra_err = std::max(intra_err, abs(ctx.rank_sum[p] - exact_rank).convert_to<FLOAT_T>());
+		exact += exact_rank;
+		node_total += ctx.rank_sum[p];
+	}
+	inter_err = abs(final_sum - node_total).convert_to<FLOAT_T>();
+	total_err = abs(final_sum - exact).convert_to<FLOAT_T>();
+
+	pv.d = final_sum;
+	printf("%d\t%lld\t%s\t%s\t%s\t%s\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+		numtasks, job.len, topo, distr, algo, name.c_str(), node.height < 0 ? -1 : height + node.height,
+		ctime + (std::isnan(itime) ? 0.0 : itime) + rtime, final_sum, final_sum, pv.u, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s thread partials (%d threads)\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, name.c_str(), node.threads, chunk / node.threads - 1,
+		ctime, nan(""), nan(""), nan(""), seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s intra-node error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, name.c_str(), node.height,
+		itime, intra_err, intra_err, intra_err, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s inter-node error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, name.c_str(), height,
+		rtime, inter_err, inter_err, inter_err, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, name.c_str(), node.height < 0 ? -1 : height + node.height,
+		nan(""), total_err, total_err, total_err, seed);
+}
+
+void run_topo(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks;
+	long long i, chunk = job.len / numtasks, height;
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	std::string name = "Topology " + job.variant.substr(5) + " (";
+	level_tree_t how;
+	FLOAT_T localsum, flat_sum, topo_sum, starttime, t, flat_time, topo_time;
+	FLOAT_T flat_err, topo_err;
+	mpfr_float_1000 exact;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
+
+	parse_level_tree(job.variant.substr(5), &how);
+	for (size_t l = 0; l < ctx.hier.name.size(); l++) {
+		name += (l == 0 ? "" : ",") + ctx.hier.name[l];
+	}
+	name += ")";
+	height = topo_height(ctx.hier, how);
+	localsum = dot(chunk, ctx.a + chunk*taskid, ctx.b + chunk*taskid);
+
+	/* Same partials both ways, each timed to the last rank done */
+	MPI_Barrier(MPI_COMM_WORLD);
+	starttime = MPI_Wtime();
+	MPI_Reduce(&localsum, &flat_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	t = MPI_Wtime() - starttime;
+	MPI_Reduce(&t, &flat_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	MPI_Barrier(MPI_COMM_WORLD);
+	starttime = MPI_Wtime();
+	topo_reduce(&localsum, &topo_sum, 1, ctx.hier, how);
+	t = MPI_Wtime() - starttime;
+	MPI_Reduce(&t, &topo_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	if (taskid != 0) {
+		return;
+	}
+
+	exact = 0.0;
+	for (i = 0; i < job.len; i++) {
+		exact += mpfr_float_1000(ctx.a[i]) * ctx.b[i];
+	}
+	flat_err = abs(flat_sum - exact).convert_to<FLOAT_T>();
+	topo_err = abs(topo_sum - exact).convert_to<FLOAT_T>();
+
+	pv.d = flat_sum;
+	printf("%d\t%lld\t%s\t%s\t%s\tMPI Reduce\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+		numtasks, job.len, topo, distr, algo, (long long) ceil(log2(numtasks)),
+		flat_time, flat_sum, flat_sum, pv.u, seed);
+	pv.d = topo_sum;
+	printf("%d\t%lld\t%s\t%s\t%s\t%s\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+		numtasks, job.len, topo, distr, algo, name.c_str(), height,
+		topo_time, topo_sum, topo_sum, pv.u, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\tMPI Reduce error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, (long long) ceil(log2(numtasks)),
+		nan(""), flat_err, flat_err, flat_err, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\t%s error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, name.c_str(), height,
+		nan(""), topo_err, topo_err, topo_err, seed);
+}
+
+void run_trace(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks, k;
+	long long chunk = job.len / numtasks;
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	const char *trees = getenv("REDUCE_TREES");
+	const char *names[] = {"MPI Reduce traced", "MPI noncomm sum traced"};
+	MPI_Op ops[] = {ctx.trace_op, ctx.trace_nc_op};
+	FLOAT_T localsum, starttime, t, ttime;
+	traced_value_t leaf, out;
+	std::vector<trace_merge_t> merges;
+	reduce_tree_t tree;
+	std::string msg;
+	FILE *f;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
+
+	localsum = dot(chunk, ctx.a + chunk*taskid, ctx.b + chunk*taskid);
+	leaf = trace_leaf(localsum, taskid);
+	for (k = 0; k < 2; k++) {
+		trace_clear();
+		MPI_Barrier(MPI_COMM_WORLD);
+		starttime = MPI_Wtime();
+		MPI_Reduce(&leaf, &out, 1, ctx.trace_type, ops[k], 0, MPI_COMM_WORLD);
+		t = MPI_Wtime() - starttime;
+		MPI_Reduce(&t, &ttime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+		trace_gather(MPI_COMM_WORLD, 0, merges);
+		if (taskid != 0) {
+			continue;
+		}
+		if (trace_tree(numtasks, merges, &tree, msg) != 0) {
+			fprintf(stderr, "%s: %s\n", names[k], msg.c_str());
+			tree.height = -1;
+		} else if (tree.duplicates > 0 || tree.conflicts > 0) {
+			fprintf(stderr, "%s: %lld merges logged more than once, %lld naming a subtree built otherwise\n",
+				names[k], tree.duplicates, tree.conflicts);
+		}
+		if (tree.conflicts > 0) {
+			/* The tree is only that of the first merges */
+			tree.height = -1;
+		} else if (tree.height >= 0 && tree.height != out.height) {
+			fprintf(stderr, "%s: tree height %lld, carried height %d\n",
+				names[k], tree.height, out.height);
+		}
+		pv.d = out.val;
+		printf("%d\t%lld\t%s\t%s\t%s\t%s\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+			numtasks, job.len, topo, distr, algo, names[k], tree.height,
+			ttime, out.val, out.val, pv.u, seed);
+		if (trees == NULL || trees[0] == '\0' || tree.height < 0) {
+			continue;
+		}
+		/* One line per tree: where it came from, leaf depths by rank, the tree */
+		f = fopen(trees, "a");
+		if (f == NULL) {
+			fprintf(stderr, "Could not open %s\n", trees);
+			continue;
+		}
+		fprintf(f, "%d\t%s\t%s\t%s\t%u\t%lld\t", numtasks, topo, algo, names[k], seed, tree.height);
+		for (size_t r = 0; r < tree.depth.size(); r++) {
+			fprintf(f, r == 0 ? "%lld" : ",%lld", tree.depth[r]);
+		}
+		fprintf(f, "\t%s\n", tree.encoding.c_str());
+		fclose(f);
+	}
+}
+
+void run_subnormal(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks, k, f;
+	int flushes = fp_flush_supported() ? 2 : 1;
+	long long i, chunk = job.len / numtasks, height;
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	const char *names[] = {"MPI Reduce", "MPI noncomm sum"};
+	MPI_Op ops[] = {MPI_SUM, ctx.nc_sum_op};
+	MPI_Op counting[] = {ctx.subn_op, ctx.subn_nc_op};
+	FLOAT_T localsum, sum, unused, starttime, t, rtime, err, val;
+	long long mine[2], all[2];
+	subn_count_t local;
+	mpfr_float_1000 exact;
+	std::string name;
+	bool was;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
+
+	if (taskid == 0) {
+		exact = 0.0;
+		for (i = 0; i < job.len; i++) {
+			exact += mpfr_float_1000(ctx.a[i]) * ctx.b[i];
+		}
+	}
+	/* Without support for flushing there are only the unflushed rows */
+	for (f = 0; f < flushes; f++) {
+		for (k = 0; k < 2; k++) {
+			was = fp_flush(f == 1);
+			MPI_Barrier(MPI_COMM_WORLD);
+			starttime = MPI_Wtime();
+			localsum = dot(chunk, ctx.a + chunk*taskid, ctx.b + chunk*taskid);
+			MPI_Reduce(&localsum, &sum, 1, MPI_DOUBLE, ops[k], 0, MPI_COMM_WORLD);
+			t = MPI_Wtime() - starttime;
+			/* Counted apart, so counting is not in the time */
+			local = subnormal_dot_count(ctx.a + chunk*taskid, ctx.b + chunk*taskid, chunk);
+			mpi_subnormal_counts = subn_count_t{0, 0, 0};
+			MPI_Reduce(&localsum, &unused, 1, MPI_DOUBLE, counting[k], 0, MPI_COMM_WORLD);
+			fp_flush(was);
+			mine[0] = local.consumed + mpi_subnormal_counts.consumed;
+			mine[1] = local.produced + mpi_subnormal_counts.produced;
+			MPI_Reduce(mine, all, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+			MPI_Reduce(&t, &rtime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+			if (taskid != 0) {
+				continue;
+			}
+			name = std::string(names[k]) + (f == 1 ? " FTZ" : "");
+			height = k == 0 ? (long long) ceil(log2(numtasks)) : (long long) numtasks-1;
+			err = abs(sum - exact).convert_to<FLOAT_T>();
+			pv.d = sum;
+			printf("%d\t%lld\t%s\t%s\t%s\t%s\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+				numtasks, job.len, topo, distr, algo, name.c_str(), height,
+				rtime, sum, sum, pv.u, seed);
+			printf("%d\t%lld\t%s\t%s\t%s\t%s error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+				numtasks, job.len, topo, distr, algo, name.c_str(), height,
+				nan(""), err, err, err, seed);
+			/* Of the local dot products and the reduction, over all ranks */
+			val = (FLOAT_T) all[0];
+			printf("%d\t%lld\t%s\t%s\t%s\t%s subnormal in\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+				numtasks, job.len, topo, distr, algo, name.c_str(), height,
+				nan(""), val, val, val, seed);
+			val = (FLOAT_T) all[1];
+			printf("%d\t%lld\t%s\t%s\t%s\t%s subnormal out\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+				numtasks, job.len, topo, distr, algo, name.c_str(), height,
+				nan(""), val, val, val, seed);
+		}
+	}
+}
+
+void run_allreduce(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks, p;
+	long k, K = job.batch;
+	long long i, chunk = job.len / numtasks, slice = chunk / K, ndiff;
+	long long height = (long long) ceil(log2(numtasks));
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	FLOAT_T *a = ctx.a + chunk*taskid, *b = ctx.b + chunk*taskid;
+	FLOAT_T starttime, t, atime, ctime, err, maxerr, minerr, maxdiff;
+	std::vector<FLOAT_T> local(K), out(K), ranks, rank_err;
+	std::vector<mpfr_float_1000> exact;
+	bool agree;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
+
+	for (k = 0; k < K; k++) {
+		local[k] = dot(slice, a + k*slice, b + k*slice);
+	}
+	MPI_Barrier(MPI_COMM_WORLD);
+	starttime = MPI_Wtime();
+	MPI_Allreduce(local.data(), out.data(), K, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	t = MPI_Wtime() - starttime;
+	MPI_Reduce(&t, &atime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	/* The check is what a lockstep code would pay after each allreduce */
+	MPI_Barrier(MPI_COMM_WORLD);
+	starttime = MPI_Wtime();
+	agree = allreduce_agrees(out.data(), K, MPI_COMM_WORLD);
+	t = MPI_Wtime() - starttime;
+	MPI_Reduce(&t, &ctime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	/* Every rank knows, so the results only move when they diverged */
+	if (!agree) {
+		ranks.resize(taskid == 0 ? K * numtasks : 0);
+		MPI_Gather(out.data(), K, MPI_DOUBLE, ranks.data(), K, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	}
+	if (taskid != 0) {
+		return;
+	}
+
+	exact.assign(K, mpfr_float_1000(0.0));
+	for (k = 0; k < K; k++) {
+		for (p = 0; p < numtasks; p++) {
+			for (i = p*chunk + k*slice; i < p*chunk + (k+1)*slice; i++) {
+				exact[k] += mpfr_float_1000(ctx.a[i]) * ctx.b[i];
+			}
+		}
+	}
+	if (agree) {
+		ranks = out;
+	}
+	/* Per rank, the worst element against MPFR and against rank 0. A rank
+	 * that differs from rank 0 gets a row of its own. */
+	rank_err.assign(numtasks, nan(""));
+	ndiff = 0;
+	maxdiff = maxerr = 0.0;
+	minerr = INFINITY;
+	for (p = 0; p < (agree ? 1 : numtasks); p++) {
+		err = 0.0;
+		for (k = 0; k < K; k++) {
+			err = std::max(err, abs(ranks[p*K + k] - exact[k]).convert_to<FLOAT_T>());
+			maxdiff = std::max(maxdiff, fabs(ranks[p*K + k] - out[k]));
+		}
+		maxerr = std::max(maxerr, err);
+		minerr = std::min(minerr, err);
+		if (bits_hash(&ranks[p*K], K) == bits_hash(out.data(), K)) {
+			continue;
+		}
+		ndiff++;
+		rank_err[p] = err;
+	}
+
+	pv.d = out[0];
+	printf("%d\t%lld\t%s\t%s\t%s\tMPI Allreduce\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+		numtasks, job.len, topo, distr, algo, height, atime, out[0], out[0], pv.u, seed);
+	/* Timed as the check */
+	printf("%d\t%lld\t%s\t%s\t%s\tMPI Allreduce ranks differing\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, height, ctime,
+		(double) ndiff, (double) ndiff, (double) ndiff, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\tMPI Allreduce max rank difference\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, height, nan(""), maxdiff, maxdiff, maxdiff, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\tMPI Allreduce max error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, height, nan(""), maxerr, maxerr, maxerr, seed);
+	printf("%d\t%lld\t%s\t%s\t%s\tMPI Allreduce min error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+		numtasks, job.len, topo, distr, algo, height, nan(""), minerr, minerr, minerr, seed);
+	for (p = 1; p < numtasks; p++) {
+		if (!std::isnan(rank_err[p])) {
+			printf("%d\t%lld\t%s\t%s\t%s\tMPI Allreduce rank %d error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+				numtasks, job.len, topo, distr, algo, p, height, nan(""),
+				rank_err[p], rank_err[p], rank_err[p], seed);
+		}
+	}
+}
+
+void run_tuned(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks, p, all, r;
+	long k, K = job.batch;
+	long long i, chunk = job.len / numtasks, slice = chunk / K;
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	const char *budget_env = getenv("TUNE_BUDGET"), *repro_env = getenv("TUNE_REPRODUCIBLE");
+	const char *kinds[] = {"Reduce", "Allreduce"};
+	FLOAT_T *a = ctx.a + chunk*taskid, *b = ctx.b + chunk*taskid;
+	FLOAT_T starttime, t, ttime, err;
+	double lb[2], ub[2], glb[2], gub[2];
+	std::vector<FLOAT_T> local(K), out(K);
+	std::vector<mpfr_float_1000> exact;
+	std::vector<tune_candidate_t> cand;
+	vec_bound<FLOAT_T> ab, bb;
+	tune_budget_t budget;
+	tune_algo_t chosen = TUNE_ALGOS;
+	topo_hier_t *hier = ctx.has_hier ? &ctx.hier : NULL;
+	std::string name;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
+
+	/* Every rank must pass the same budget, so the ranges are global */
+	ab = bound_of(a, chunk, 0.0);
+	bb = bound_of(b, chunk, 0.0);
+	lb[0] = ab.lb;
+	lb[1] = bb.lb;
+	ub[0] = ab.ub;
+	ub[1] = bb.ub;
+	MPI_Allreduce(lb, glb, 2, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+	MPI_Allreduce(ub, gub, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+	budget.n = slice;
+	budget.x_lb = glb[0];
+	budget.x_ub = gub[0];
+	budget.y_lb = glb[1];
+	budget.y_ub = gub[1];
+	budget.err = budget_env == NULL ? INFINITY : strtod(budget_env, NULL);
+	budget.reproducible = repro_env != NULL && std::string(repro_env) == "1";
+
+	for (k = 0; k < K; k++) {
+		local[k] = dot(slice, a + k*slice, b + k*slice);
+	}
+	if (taskid == 0) {
+		exact.assign(K, mpfr_float_1000(0.0));
+		for (k = 0; k < K; k++) {
+			for (p = 0; p < numtasks; p++) {
+				for (i = p*chunk + k*slice; i < p*chunk + (k+1)*slice; i++) {
+					exact[k] += mpfr_float_1000(ctx.a[i]) * ctx.b[i];
+				}
+			}
+		}
+	}
+	for (all = 0; all < 2; all++) {
+		/* The first call of a launch measures; time the next one */
+		for (r = 0; r < 2; r++) {
+			MPI_Barrier(MPI_COMM_WORLD);
+			starttime = MPI_Wtime();
+			if (all) {
+				chosen = tuned_allreduce(local.data(), out.data(), K, MPI_COMM_WORLD, budget, hier);
+			} else {
+				chosen = tuned_reduce(local.data(), out.data(), K, MPI_COMM_WORLD, budget, hier);
+			}
+			t = MPI_Wtime() - starttime;
+		}
+		MPI_Reduce(&t, &ttime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+		if (taskid != 0) {
+			continue;
+		}
+		/* Each candidate: its median time, height and predicted error */
+		tune_report(MPI_COMM_WORLD, K, all, budget, cand);
+		for (size_t c = 0; c < cand.size(); c++) {
+			name = std::string("Tune ") + kinds[all] + " " + tune_algo_name(cand[c].algo);
+			printf("%d\t%lld\t%s\t%s\t%s\t%s predicted error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+				numtasks, job.len, topo, distr, algo, name.c_str(), cand[c].height,
+				cand[c].time, cand[c].err, cand[c].err, cand[c].err, seed);
+		}
+		err = 0.0;
+		for (k = 0; k < K; k++) {
+			err = std::max(err, abs(out[k] - exact[k]).convert_to<FLOAT_T>());
+		}
+		name = std::string("Tuned ") + kinds[all] + " (" + tune_algo_name(chosen) + ")";
+		pv.d = out[0];
+		printf("%d\t%lld\t%s\t%s\t%s\t%s\t%lld\t%f\t%.15f\t%a\t0x%lx\t%u\n",
+			numtasks, job.len, topo, distr, algo, name.c_str(), cand.empty() ? -1 : cand[chosen].height,
+			ttime, out[0], out[0], pv.u, seed);
+		printf("%d\t%lld\t%s\t%s\t%s\t%s error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+			numtasks, job.len, topo, distr, algo, name.c_str(), cand.empty() ? -1 : cand[chosen].height,
+			nan(""), err, err, err, seed);
+	}
+}
+
+void run_product(dot_ctx &ctx, const dot_job &job, unsigned int seed)
+{
+	int taskid = ctx.taskid, numtasks = ctx.numtasks, k;
+	long long i, chunk = job.len / numtasks, height;
+	const char *topo = ctx.topo.c_str(), *algo = ctx.algo.c_str();
+	const char *distr = job.distr.c_str();
+	const char *names[] = {"MPI Reduce scaled product", "MPI noncomm scaled product"};
+	MPI_Op ops[] = {ctx.scaled_op, ctx.scaled_nc_op};
+	const FLOAT_T *mine = ctx.a + chunk*taskid;
+	FLOAT_T localprod, prod, starttime, t, rtime, err;
+	scaled_double local, out, exact;
+	union udouble {
+		double d;
+		unsigned long u;
+	} pv;
+
+	if (taskid == 0) {
+		PROF_SCOPE("exact product");
+		exact = scaled_exact_prod(ctx.a, job.len);
+	}
+	/* In double, as a loop and MPI_PROD would, underflowing or overflowing
+	 * as they do */
+	MPI_Barrier(MPI_COMM_WORLD);
+	starttime = MPI_Wtime();
+	localprod = 1.0;
+	for (i = 0; i < chunk; i++) {
+		localprod *= mine[i];
+	}
+	MPI_Reduce(&localprod, &prod, 1, MPI_DOUBLE, MPI_PROD, 0, MPI_COMM_WORLD);
+	t = MPI_Wtime() - starttime;
+	MPI_Reduce(&t, &rtime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	height = (long long) ceil(log2(numtasks));
+	if (taskid == 0) {
+		printf("%d\t%lld\t%s\t%s\t%s\tExact product\t%lld\t%f\t%s\t%s\t%s\t%u\n",
+			numtasks, job.len, topo, distr, algo, job.len-1, nan(""),
+			scaled_dec(exact).c_str(), scaled_hex(exact).c_str(), scaled_hex(exact).c_str(), seed);
+		err = scaled_rel_error(scaled_double(prod), exact);
+		pv.d = prod;
+		printf("%d\t%lld\t%s\t%s\t%s\tMPI Reduce product\t%lld\t%f\t%.15e\t%a\t0x%lx\t%u\n",
+			numtasks, job.len, topo, distr, algo, height, rtime, prod, prod, pv.u, seed);
+		printf("%d\t%lld\t%s\t%s\t%s\tMPI Reduce product relative error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+			numtasks, job.len, topo, distr, algo, height, nan(""), err, err, err, seed);
+	}
+	/* With separate exponents. FP (hex) has the whole value, as for MPFR. */
+	for (k = 0; k < 2; k++) {
+		MPI_Barrier(MPI_COMM_WORLD);
+		starttime = MPI_Wtime();
+		local = scaled_left_prod(mine, chunk);
+		MPI_Reduce(&local, &out, 1, ctx.scaled_type, ops[k], 0, MPI_COMM_WORLD);
+		t = MPI_Wtime() - starttime;
+		MPI_Reduce(&t, &rtime, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+		if (taskid != 0) {
+			continue;
+		}
+		height = k == 0 ? (long long) ceil(log2(numtasks)) : (long long) numtasks-1;
+		err = scaled_rel_error(out, exact);
+		printf("%d\t%lld\t%s\t%s\t%s\t%s\t%lld\t%f\t%s\t%s\t%s\t%u\n",
+			numtasks, job.len, topo, distr, algo, names[k], height, rtime,
+			scaled_dec(out).c_str(), scaled_hex(out).c_str(), scaled_hex(out).c_str(), seed);
+		printf("%d\t%lld\t%s\t%s\t%s\t%s relative error\t%lld\t%f\t%.20f\t%.20e\t%a\t%u\n",
+			numtasks, job.len, topo, distr, algo, names[k], height, nan(""), err, err, err, seed);
+	}
 }
 
 FLOAT_T can_mpi_dot(int numtasks, long long len, FLOAT_T* as, FLOAT_T* bs, FLOAT_T (*rand_a)(), FLOAT_T (*rand_b)(), FLOAT_T *rank_sum)
 {
-	int i, j;
-	int chunk = len/numtasks;
+	int i;
+	long long j, chunk = len/numtasks;
 	FLOAT_T can_mpi_sum = 0.0;
 	FLOAT_T localsum = 0.0;
 	for (i = 0; i < numtasks; i++) {
 		rank_sum[i] = 0.0;
 		for (j = chunk*i; j < chunk * i + chunk; j++) {
-			as[j] = rand_a();
-			bs[j] = rand_b();
+			/* Without generators as and bs are already filled */
+			if (rand_a != NULL) {
+				as[j] = rand_a();
+				bs[j] = rand_b();
+			}
 			/* // Debug
 			if (as[j] != a[j] || bs[j] != b[j]) {
 					fprintf(stderr, "Results differ: (%a != %a, %a != %a)\n",
@@ -0,0 +1,212 @@
+/* Implementation of the fast error bounds. See error_bounds.hxx */
+#ifndef ERROR_BOUNDS_CXX
+#define ERROR_BOUNDS_CXX
+
+#include "error_bounds.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/* Directed rounding: the round-to-nearest result is within half an ulp of the
+ * exact one, so one step toward +/-inf bounds it. NaN (e.g. 0 * inf once a
+ * bound is lost) becomes the infinite bound. */
+static inline double up(double r)
+{
+	return isnan(r) ? INFINITY : nextafter(r, INFINITY);
+}
+static inline double down(double r)
+{
+	return isnan(r) ? -INFINITY : nextafter(r, -INFINITY);
+}
+
+/* Largest absolute value in [lb, ub] */
+static inline double inf_norm(double lb, double ub)
+{
+	return max(fabs(lb), fabs(ub));
+}
+
+/* Smallest absolute value in [lb, ub] */
+static inline double min_abs(double lb, double ub)
+{
+	return (lb <= 0.0 && ub >= 0.0) ? 0.0 : min(fabs(lb), fabs(ub));
+}
+
+template <typename FLOAT_T>
+double gamma_bound(long long n)
+{
+	double ne = up((double) n * bound_eps<FLOAT_T>());
+	double den = down(1.0 - ne);
+	if (den <= 0.0) {
+		return INFINITY;
+	}
+	return up(ne / den);
+}
+
+template <typename FLOAT_T>
+vec_bound<FLOAT_T> bound_of(const FLOAT_T *x, long long n, double err)
+{
+	vec_bound<FLOAT_T> v = {n, 0.0, 0.0, err};
+	if (n <= 0) {
+		return v;
+	}
+	FLOAT_T lo = x[0], hi = x[0];
+	for (long long i = 1; i < n; i++) {
+		lo = x[i] < lo ? x[i] : lo;
+		hi = x[i] > hi ? x[i] : hi;
+	}
+	v.lb = lo;
+	v.ub = hi;
+	return v;
+}
+
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> dot_bound(const vec_bound<FLOAT_T> &x, const vec_bound<FLOAT_T> &y)
+{
+	long long n = x.n;
+	double dn = (double) n;
+	double x_mag = inf_norm(x.lb, x.ub);
+	double y_mag = inf_norm(y.lb, y.ub);
+	double lb, ub, err, subn;
+
+	/* Range of each product x_i * y_i */
+	lb = min(min(x.lb * y.lb, x.lb * y.ub), min(x.ub * y.lb, x.ub * y.ub));
+	ub = max(max(x.lb * y.lb, x.lb * y.ub), max(x.ub * y.lb, x.ub * y.ub));
+
+	/* Products can underflow; each contributes at most mach_del */
+	subn = 0.0;
+	if (min_abs(x.lb, x.ub) * min_abs(y.lb, y.ub) < numeric_limits<FLOAT_T>::min()) {
+		subn = up(up(dn * bound_del<FLOAT_T>()) * up(1.0 + gamma_bound<FLOAT_T>(n-1)));
+	}
+
+	/* Error already in the inputs, |dx| |y| + |dy| |x| + |dx| |dy| per term */
+	err = up(up(x.err * y_mag) + up(y.err * x_mag));
+	err = up(dn * up(err + up(x.err * y.err)));
+	/* |x| . |y| gamma_n + n del (1 + gamma_{n-1}) */
+	err = up(err + up(up(up(x_mag * y_mag) * dn) * gamma_bound<FLOAT_T>(n)));
+	err = up(err + subn);
+
+	scal_bound<FLOAT_T> s = {down(dn * down(lb)), up(dn * up(ub)), err};
+	return s;
+}
+
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> sum_bound(const vec_bound<FLOAT_T> &x)
+{
+	long long n = x.n;
+	double dn = (double) n;
+	double mag = inf_norm(x.lb, x.ub);
+	/* Additions are exact on underflow, so only gamma_{n-1} sum |x_i| */
+	double err = up(dn * x.err);
+	err = up(err + up(up(dn * mag) * gamma_bound<FLOAT_T>(n-1)));
+	scal_bound<FLOAT_T> s = {down(dn * x.lb), up(dn * x.ub), err};
+	return s;
+}
+
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> add_bound(const scal_bound<FLOAT_T> &a, const scal_bound<FLOAT_T> &b)
+{
+	scal_bound<FLOAT_T> s;
+	s.lb = down(a.lb + b.lb);
+	s.ub = up(a.ub + b.ub);
+	/* Propagated error, then rounding of a computed sum of size up to
+	 * |a + b| + err */
+	s.err = up(a.err + b.err);
+	s.err = up(s.err + up(bound_u<FLOAT_T>() * up(inf_norm(s.lb, s.ub) + s.err)));
+	return s;
+}
+
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> neg_bound(const scal_bound<FLOAT_T> &a)
+{
+	scal_bound<FLOAT_T> s = {-a.ub, -a.lb, a.err};
+	return s;
+}
+
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> mul_bound(const scal_bound<FLOAT_T> &a, const scal_bound<FLOAT_T> &b)
+{
+	scal_bound<FLOAT_T> s;
+	double a_mag = inf_norm(a.lb, a.ub);
+	double b_mag = inf_norm(b.lb, b.ub);
+	s.lb = down(min(min(a.lb * b.lb, a.lb * b.ub), min(a.ub * b.lb, a.ub * b.ub)));
+	s.ub = up(max(max(a.lb * b.lb, a.lb * b.ub), max(a.ub * b.lb, a.ub * b.ub)));
+	/* |da| |b| + |db| |a| + |da| |db| */
+	s.err = up(up(a.err * b_mag) + up(b.err * a_mag));
+	s.err = up(s.err + up(a.err * b.err));
+	/* Rounding of the computed product, which may also underflow */
+	s.err = up(s.err + up(bound_u<FLOAT_T>() * up(up(a_mag + a.err) * up(b_mag + b.err))));
+	if (min_abs(a.lb, a.ub) * min_abs(b.lb, b.ub) < numeric_limits<FLOAT_T>::min()) {
+		s.err = up(s.err + bound_del<FLOAT_T>());
+	}
+	return s;
+}
+
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> div_bound(const scal_bound<FLOAT_T> &a, const scal_bound<FLOAT_T> &b)
+{
+	scal_bound<FLOAT_T> s;
+	/* Smallest the exact and computed divisors can be */
+	double b_min = min_abs(down(b.lb - b.err), up(b.ub + b.err));
+	if (b_min == 0.0) {
+		s.lb = -INFINITY;
+		s.ub = INFINITY;
+		s.err = INFINITY;
+		return s;
+	}
+	s.lb = down(min(min(a.lb / b.lb, a.lb / b.ub), min(a.ub / b.lb, a.ub / b.ub)));
+	s.ub = up(max(max(a.lb / b.lb, a.lb / b.ub), max(a.ub / b.lb, a.ub / b.ub)));
+	/* a'/b' - a/b = (a' - a)/b' - (a/b)(b' - b)/b' */
+	double q = inf_norm(s.lb, s.ub);
+	s.err = up(up(a.err + up(q * b.err)) / b_min);
+	s.err = up(s.err + up(bound_u<FLOAT_T>() * up(q + s.err)));
+	if (min_abs(a.lb, a.ub) < up(numeric_limits<FLOAT_T>::min() * inf_norm(b.lb, b.ub))) {
+		s.err = up(s.err + bound_del<FLOAT_T>());
+	}
+	return s;
+}
+
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> sqrt_bound(const scal_bound<FLOAT_T> &a)
+{
+	scal_bound<FLOAT_T> s;
+	if (a.ub < 0.0) {
+		s.lb = s.ub = NAN;
+		s.err = INFINITY;
+		return s;
+	}
+	double lb = max(a.lb, 0.0);
+	double lb_c = max(down(a.lb - a.err), 0.0); // Smallest computed argument
+	s.lb = down(sqrt(lb));
+	s.ub = up(sqrt(a.ub));
+	/* |sqrt(a') - sqrt(a)| is at most sqrt|a' - a|, and also
+	 * |a' - a| / (sqrt(a') + sqrt(a)) */
+	s.err = up(sqrt(a.err));
+	double den = down(down(sqrt(lb_c)) + s.lb);
+	if (den > 0.0) {
+		s.err = min(s.err, up(a.err / den));
+	}
+	s.err = up(s.err + up(bound_u<FLOAT_T>() * up(sqrt(up(a.ub + a.err)))));
+	return s;
+}
+
+/* Explicit template instantiation. */
+template double gamma_bound<float>(long long n);
+template double gamma_bound<double>(long long n);
+template vec_bound<float> bound_of(const float *x, long long n, double err);
+template vec_bound<double> bound_of(const double *x, long long n, double err);
+template scal_bound<float> dot_bound(const vec_bound<float> &x, const vec_bound<float> &y);
+template scal_bound<double> dot_bound(const vec_bound<double> &x, const vec_bound<double> &y);
+template scal_bound<float> sum_bound(const vec_bound<float> &x);
+template scal_bound<double> sum_bound(const vec_bound<double> &x);
+#define SCAL_OPS(T) \
+	template scal_bound<T> add_bound(const scal_bound<T> &a, const scal_bound<T> &b); \
+	template scal_bound<T> neg_bound(const scal_bound<T> &a); \
+	template scal_bound<T> mul_bound(const scal_bound<T> &a, const scal_bound<T> &b); \
+	template scal_bound<T> div_bound(const scal_bound<T> &a, const scal_bound<T> &b); \
+	template scal_bound<T> sqrt_bound(const scal_bound<T> &a);
+SCAL_OPS(float)
+SCAL_OPS(double)
+
+#endif
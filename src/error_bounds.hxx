@@ -0,0 +1,83 @@
+/* Fast error bounds for float and double.
+ * These follow the same formulas as error_semantics, but every bound is
+ * carried in double arithmetic rounded upward (each result is nudged one ulp
+ * toward +inf), so they never understate the exact value while needing no
+ * MPFR and no allocation. Vectors are described by a view (n, range, error)
+ * rather than owned copies. error_semantics remains as the MPFR backend for
+ * verifying these; build with MPFR_BOUNDS=1 to compare the two.
+ *
+ * As with random_reduction_tree, definitions live in error_bounds.cxx with
+ * explicit instantiations for float and double only.
+ */
+#ifndef ERROR_BOUNDS_HXX
+#define ERROR_BOUNDS_HXX
+
+#include <limits>
+
+/* Bounds on a vector of n elements, each in [lb, ub] and each already
+ * carrying at most err absolute error */
+template <typename FLOAT_T>
+struct vec_bound {
+	long long n;
+	double lb;
+	double ub;
+	double err;
+};
+
+/* Bounds on a scalar in [lb, ub] with at most err absolute error */
+template <typename FLOAT_T>
+struct scal_bound {
+	double lb;
+	double ub;
+	double err;
+};
+
+/* Machine epsilon, unit roundoff and smallest subnormal */
+template <typename FLOAT_T>
+constexpr double bound_eps()
+{
+	return std::numeric_limits<FLOAT_T>::epsilon();
+}
+template <typename FLOAT_T>
+constexpr double bound_u()
+{
+	return std::numeric_limits<FLOAT_T>::epsilon() / 2;
+}
+template <typename FLOAT_T>
+constexpr double bound_del()
+{
+	return std::numeric_limits<FLOAT_T>::denorm_min();
+}
+
+/* Upper bound on gamma_n = n eps / (1 - n eps). Infinite if n eps >= 1. */
+template <typename FLOAT_T>
+double gamma_bound(long long n);
+
+/* Describe x[0..n-1] without copying it. O(n) scan for the range. */
+template <typename FLOAT_T>
+vec_bound<FLOAT_T> bound_of(const FLOAT_T *x, long long n, double err);
+
+/* Error bound of a dot product (cf. dot_e) */
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> dot_bound(const vec_bound<FLOAT_T> &x, const vec_bound<FLOAT_T> &y);
+
+/* Error bound of summing all elements of x in any order */
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> sum_bound(const vec_bound<FLOAT_T> &x);
+
+/* Single rounded operations on scalars, or elementwise on vectors. Here
+ * [lb, ub] encloses the exact value and the computed one is within err of
+ * it. Division by a range that may hold 0, or sqrt of one that is entirely
+ * negative, gives an infinite error. */
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> add_bound(const scal_bound<FLOAT_T> &a, const scal_bound<FLOAT_T> &b);
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> neg_bound(const scal_bound<FLOAT_T> &a);
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> mul_bound(const scal_bound<FLOAT_T> &a, const scal_bound<FLOAT_T> &b);
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> div_bound(const scal_bound<FLOAT_T> &a, const scal_bound<FLOAT_T> &b);
+template <typename FLOAT_T>
+scal_bound<FLOAT_T> sqrt_bound(const scal_bound<FLOAT_T> &a);
+
+#endif
@@ -0,0 +1,391 @@
+/* Implementation of bound_dag. See error_dag.hxx */
+#ifndef ERROR_DAG_CXX
+#define ERROR_DAG_CXX
+
+#include "error_dag.hxx"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+template <typename FLOAT_T>
+static scal_bound<FLOAT_T> to_scal(const vec_bound<FLOAT_T> &v)
+{
+	scal_bound<FLOAT_T> s = {v.lb, v.ub, v.err};
+	return s;
+}
+
+template <typename FLOAT_T>
+static vec_bound<FLOAT_T> to_vec(long long n, const scal_bound<FLOAT_T> &s)
+{
+	vec_bound<FLOAT_T> v = {n, s.lb, s.ub, s.err};
+	return v;
+}
+
+template <typename FLOAT_T>
+static bool same(const vec_bound<FLOAT_T> &x, const vec_bound<FLOAT_T> &y)
+{
+	return x.n == y.n && x.lb == y.lb && x.ub == y.ub && x.err == y.err;
+}
+
+template <typename FLOAT_T>
+bound_dag<FLOAT_T>::bound_dag() : iter_(-1), evals_(0) { };
+
+template <typename FLOAT_T>
+bound_dag<FLOAT_T>::~bound_dag() { };
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::check(node_t v)
+{
+	if (v < 0 || v >= (node_t) nodes_.size()) {
+		fprintf(stderr, "bound_dag: no node %d\n", v);
+		throw DAG_EXCEPTION;
+	}
+}
+
+template <typename FLOAT_T>
+typename bound_dag<FLOAT_T>::node_t bound_dag<FLOAT_T>::make(
+		kind_t kind, node_t a, node_t b, long long n,
+		long long k, double plb, double pub)
+{
+	key_t key = make_pair(make_pair((int) kind, make_pair(a, b)),
+	                      make_pair(k, make_pair(plb, pub)));
+	typename map<key_t, node_t>::iterator it = memo_.find(key);
+	if (it != memo_.end()) {
+		return it->second;
+	}
+	node c;
+	c.kind = kind;
+	c.a = a;
+	c.b = b;
+	c.k = k;
+	c.plb = plb;
+	c.pub = pub;
+	c.val = c.init = vec_bound<FLOAT_T>{n, 0.0, 0.0, 0.0};
+	c.dirty = true;
+	node_t v = (node_t) nodes_.size();
+	nodes_.push_back(c);
+	nodes_[a].users.push_back(v);
+	if (b >= 0 && b != a) {
+		nodes_[b].users.push_back(v);
+	}
+	memo_[key] = v;
+	return v;
+}
+
+template <typename FLOAT_T>
+typename bound_dag<FLOAT_T>::node_t bound_dag<FLOAT_T>::input(
+		long long n, double lb, double ub, double err)
+{
+	node c;
+	c.kind = INPUT;
+	c.a = c.b = -1;
+	c.k = 0;
+	c.plb = c.pub = 0.0;
+	c.val = vec_bound<FLOAT_T>{n, lb, ub, err};
+	c.init = c.val;
+	c.dirty = false;
+	nodes_.push_back(c);
+	return (node_t) nodes_.size() - 1;
+}
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::set_input(node_t v, double lb, double ub, double err)
+{
+	check(v);
+	if (nodes_[v].kind != INPUT) {
+		fprintf(stderr, "bound_dag: node %d is not an input\n", v);
+		throw DAG_EXCEPTION;
+	}
+	vec_bound<FLOAT_T> b = {nodes_[v].val.n, lb, ub, err};
+	nodes_[v].init = b;
+	assign(v, b);
+	truncate(0);
+}
+
+template <typename FLOAT_T>
+typename bound_dag<FLOAT_T>::node_t bound_dag<FLOAT_T>::dot(node_t x, node_t y)
+{
+	check(x);
+	check(y);
+	if (nodes_[x].val.n != nodes_[y].val.n) {
+		fprintf(stderr, "bound_dag: dot of lengths %lld and %lld\n",
+			nodes_[x].val.n, nodes_[y].val.n);
+		throw DAG_EXCEPTION;
+	}
+	/* x . y == y . x */
+	return make(DOT, min(x, y), max(x, y), 1, 0, 0.0, 0.0);
+}
+
+template <typename FLOAT_T>
+typename bound_dag<FLOAT_T>::node_t bound_dag<FLOAT_T>::sum(node_t x)
+{
+	check(x);
+	return make(SUM, x, -1, 1, 0, 0.0, 0.0);
+}
+
+template <typename FLOAT_T>
+typename bound_dag<FLOAT_T>::node_t bound_dag<FLOAT_T>::matvec(
+		node_t x, long long k, double a_lb, double a_ub)
+{
+	check(x);
+	return make(MATVEC, x, -1, nodes_[x].val.n, k, a_lb, a_ub);
+}
+
+#define ELEMENTWISE(NAME, KIND, COMMUTES) \
+template <typename FLOAT_T> \
+typename bound_dag<FLOAT_T>::node_t bound_dag<FLOAT_T>::NAME(node_t a, node_t b) \
+{ \
+	check(a); \
+	check(b); \
+	long long na = nodes_[a].val.n, nb = nodes_[b].val.n; \
+	if (na != nb && na != 1 && nb != 1) { \
+		fprintf(stderr, "bound_dag: " #NAME " of lengths %lld and %lld\n", na, nb); \
+		throw DAG_EXCEPTION; \
+	} \
+	if (COMMUTES && b < a) { \
+		swap(a, b); \
+	} \
+	return make(KIND, a, b, max(na, nb), 0, 0.0, 0.0); \
+}
+ELEMENTWISE(add, ADD, true)
+ELEMENTWISE(sub, SUB, false)
+ELEMENTWISE(mul, MUL, true)
+ELEMENTWISE(div, DIV, false)
+#undef ELEMENTWISE
+
+template <typename FLOAT_T>
+typename bound_dag<FLOAT_T>::node_t bound_dag<FLOAT_T>::sqrt(node_t a)
+{
+	check(a);
+	return make(SQRT, a, -1, nodes_[a].val.n, 0, 0.0, 0.0);
+}
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::carry(node_t out, node_t in)
+{
+	check(out);
+	check(in);
+	if (nodes_[in].kind != INPUT || nodes_[in].val.n != nodes_[out].val.n) {
+		fprintf(stderr, "bound_dag: cannot carry node %d into %d\n", out, in);
+		throw DAG_EXCEPTION;
+	}
+	carried_.push_back(make_pair(out, in));
+	truncate(0);
+}
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::watch(node_t v)
+{
+	check(v);
+	watched_.push_back(v);
+	truncate(0);
+}
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::observe(long iter, node_t v, double lb, double ub)
+{
+	check(v);
+	obs_[make_pair(iter, v)] = make_pair(lb, ub);
+	observed_.insert(v);
+	truncate(iter);
+}
+
+/* Mark everything downstream of v as needing evaluation */
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::mark(node_t v)
+{
+	typename vector<node_t>::iterator u;
+	for (u = nodes_[v].users.begin(); u != nodes_[v].users.end(); u++) {
+		if (!nodes_[*u].dirty) {
+			nodes_[*u].dirty = true;
+			mark(*u);
+		}
+	}
+	if (nodes_[v].kind != INPUT) {
+		nodes_[v].dirty = true;
+	}
+}
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::assign(node_t v, const vec_bound<FLOAT_T> &b)
+{
+	if (!same(nodes_[v].val, b)) {
+		nodes_[v].val = b;
+		mark(v);
+	}
+}
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::truncate(long iter)
+{
+	if (iter <= 0) {
+		start_.clear();
+		results_.clear();
+		return;
+	}
+	if ((long) results_.size() > iter) {
+		results_.resize(iter);
+	}
+	if ((long) start_.size() > iter + 1) {
+		start_.resize(iter + 1);
+	}
+}
+
+template <typename FLOAT_T>
+vec_bound<FLOAT_T> bound_dag<FLOAT_T>::eval(node_t v)
+{
+	check(v);
+	if (nodes_[v].dirty) {
+		compute(v);
+	}
+	return nodes_[v].val;
+}
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::compute(node_t v)
+{
+	node &c = nodes_[v];
+	long long n = c.val.n;
+	vec_bound<FLOAT_T> a, row;
+	switch (c.kind) {
+	case INPUT:
+		break;
+	case DOT:
+		c.val = to_vec(1, dot_bound(eval(c.a), eval(c.b)));
+		break;
+	case SUM:
+		c.val = to_vec(1, sum_bound(eval(c.a)));
+		break;
+	case MATVEC:
+		/* Each element is a dot product of length k */
+		a = eval(c.a);
+		a.n = c.k;
+		row = vec_bound<FLOAT_T>{c.k, c.plb, c.pub, 0.0};
+		c.val = to_vec(n, dot_bound(row, a));
+		break;
+	case ADD:
+		c.val = to_vec(n, add_bound(to_scal(eval(c.a)), to_scal(eval(c.b))));
+		break;
+	case SUB:
+		c.val = to_vec(n, add_bound(to_scal(eval(c.a)), neg_bound(to_scal(eval(c.b)))));
+		break;
+	case MUL:
+		c.val = to_vec(n, mul_bound(to_scal(eval(c.a)), to_scal(eval(c.b))));
+		break;
+	case DIV:
+		c.val = to_vec(n, div_bound(to_scal(eval(c.a)), to_scal(eval(c.b))));
+		break;
+	case SQRT:
+		c.val = to_vec(n, sqrt_bound(to_scal(eval(c.a))));
+		break;
+	}
+	/* Replace the range by the one observed at this iteration */
+	typename map<pair<long, node_t>, pair<double, double> >::iterator o;
+	o = obs_.find(make_pair(iter_, v));
+	if (o != obs_.end()) {
+		c.val.lb = o->second.first;
+		c.val.ub = o->second.second;
+	}
+	c.dirty = false;
+	evals_++;
+}
+
+template <typename FLOAT_T>
+void bound_dag<FLOAT_T>::run(long iters)
+{
+	size_t i;
+	typename set<node_t>::iterator o;
+	typename map<pair<long, node_t>, pair<double, double> >::iterator ob;
+	vector<vec_bound<FLOAT_T> > next, res;
+	if (start_.empty()) {
+		for (i = 0; i < carried_.size(); i++) {
+			next.push_back(nodes_[carried_[i].second].init);
+		}
+		start_.push_back(next);
+	}
+	for (long k = (long) results_.size(); k < iters; k++) {
+		iter_ = k;
+		/* Inputs: carried values from the previous iteration, or the initial
+		 * ones, with their observed range if any */
+		for (node_t v = 0; v < (node_t) nodes_.size(); v++) {
+			if (nodes_[v].kind != INPUT) {
+				continue;
+			}
+			vec_bound<FLOAT_T> b = nodes_[v].init;
+			for (i = 0; i < carried_.size(); i++) {
+				if (carried_[i].second == v) {
+					b = start_[k][i];
+				}
+			}
+			ob = obs_.find(make_pair(iter_, v));
+			if (ob != obs_.end()) {
+				b.lb = ob->second.first;
+				b.ub = ob->second.second;
+			}
+			assign(v, b);
+		}
+		for (o = observed_.begin(); o != observed_.end(); o++) {
+			if (nodes_[*o].kind != INPUT) {
+				mark(*o);
+			}
+		}
+		res.clear();
+		for (i = 0; i < watched_.size(); i++) {
+			res.push_back(eval(watched_[i]));
+		}
+		results_.push_back(res);
+		next.clear();
+		for (i = 0; i < carried_.size(); i++) {
+			next.push_back(eval(carried_[i].first));
+		}
+		if ((long) start_.size() == k + 1) {
+			start_.push_back(next);
+		} else {
+			start_[k+1] = next;
+		}
+	}
+	/* Observed ranges only apply inside run() */
+	iter_ = -1;
+	for (o = observed_.begin(); o != observed_.end(); o++) {
+		mark(*o);
+	}
+}
+
+template <typename FLOAT_T>
+long bound_dag<FLOAT_T>::iterations() const
+{
+	return (long) results_.size();
+}
+
+template <typename FLOAT_T>
+vec_bound<FLOAT_T> bound_dag<FLOAT_T>::result(long iter, node_t v)
+{
+	size_t i;
+	for (i = 0; i < watched_.size(); i++) {
+		if (watched_[i] == v) {
+			break;
+		}
+	}
+	if (i == watched_.size() || iter < 0) {
+		fprintf(stderr, "bound_dag: node %d is not watched\n", v);
+		throw DAG_EXCEPTION;
+	}
+	if (iter >= (long) results_.size()) {
+		run(iter + 1);
+	}
+	return results_[iter][i];
+}
+
+template <typename FLOAT_T>
+long long bound_dag<FLOAT_T>::evaluations() const
+{
+	return evals_;
+}
+
+/* Explicit template instantiation. */
+template class bound_dag<float>;
+template class bound_dag<double>;
+
+#endif
@@ -0,0 +1,97 @@
+/* Error-propagation DAG built on error_bounds.
+ * Build the operations of, e.g., one CG iteration once, then evaluate bounds
+ * as inputs, observed ranges or the number of iterations change:
+ * - Identical operations on identical operands return the same node, so
+ *   shared subexpressions are built and evaluated once.
+ * - Nodes are evaluated lazily and only if something they depend on changed.
+ * - carry(out, in) feeds out of iteration k into in of iteration k+1. The
+ *   carried values at the start of every iteration are kept, so run() only
+ *   computes iterations it has not done yet, and observe() or set_input()
+ *   restart from the first iteration they affect.
+ * Pure interval arithmetic on a solver loses all information within a few
+ * iterations (e.g. a divisor whose range reaches 0), so observe() lets the
+ * range of any node be replaced by the one actually seen in a run; the
+ * error is still propagated rigorously.
+ *
+ * Scalars are vectors with n = 1 and are broadcast in elementwise operations.
+ */
+#ifndef ERROR_DAG_HXX
+#define ERROR_DAG_HXX
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "error_bounds.hxx"
+
+#define DAG_EXCEPTION 6
+
+template <typename FLOAT_T>
+class bound_dag {
+	public:
+		typedef int node_t;
+		bound_dag();
+		~bound_dag();
+		/* Leaves. Changing an input invalidates all iterations. */
+		node_t input(long long n, double lb, double ub, double err);
+		void set_input(node_t v, double lb, double ub, double err);
+		/* Reductions */
+		node_t dot(node_t x, node_t y);
+		node_t sum(node_t x);
+		/* y = A x where each row of A has k nonzeros in [a_lb, a_ub] */
+		node_t matvec(node_t x, long long k, double a_lb, double a_ub);
+		/* Elementwise */
+		node_t add(node_t a, node_t b);
+		node_t sub(node_t a, node_t b);
+		node_t mul(node_t a, node_t b);
+		node_t div(node_t a, node_t b);
+		node_t sqrt(node_t a);
+		/* Iteration */
+		void carry(node_t out, node_t in);
+		void watch(node_t v);
+		void observe(long iter, node_t v, double lb, double ub);
+		void run(long iters);
+		long iterations() const;
+		/* Bound of a watched node after iteration iter (0-based) */
+		vec_bound<FLOAT_T> result(long iter, node_t v);
+		/* Bound of any node at its current state, outside of run() */
+		vec_bound<FLOAT_T> eval(node_t v);
+		/* Number of node evaluations so far, to see what was reused */
+		long long evaluations() const;
+	private:
+		enum kind_t { INPUT, DOT, SUM, MATVEC, ADD, SUB, MUL, DIV, SQRT };
+		struct node {
+			kind_t kind;
+			node_t a, b;
+			long long k;
+			double plb, pub;           // matvec coefficient range
+			vec_bound<FLOAT_T> val;
+			vec_bound<FLOAT_T> init;   // Value set by the user, for inputs
+			bool dirty;
+			std::vector<node_t> users; // Nodes with this one as operand
+		};
+		typedef std::pair<std::pair<int, std::pair<node_t, node_t> >,
+		                  std::pair<long long, std::pair<double, double> > > key_t;
+		node_t make(kind_t kind, node_t a, node_t b, long long n,
+		            long long k, double plb, double pub);
+		void check(node_t v);
+		void mark(node_t v);
+		void assign(node_t v, const vec_bound<FLOAT_T> &b);
+		void compute(node_t v);
+		void truncate(long iter);
+		std::vector<node> nodes_;
+		std::map<key_t, node_t> memo_;
+		std::vector<std::pair<node_t, node_t> > carried_;  // (out, in)
+		std::vector<node_t> watched_;
+		std::map<std::pair<long, node_t>, std::pair<double, double> > obs_;
+		std::set<node_t> observed_;
+		/* start_[k] are the carried inputs at the start of iteration k,
+		 * results_[k] the watched nodes after it */
+		std::vector<std::vector<vec_bound<FLOAT_T> > > start_;
+		std::vector<std::vector<vec_bound<FLOAT_T> > > results_;
+		long iter_;               // Iteration being evaluated, -1 outside run()
+		long long evals_;
+};
+
+#endif
@@ -0,0 +1,227 @@
+/* Implementation of the random-association error predictor.
+ * See error_predict.hxx for the model.
+ */
+#ifndef ERROR_PREDICT_CXX
+#define ERROR_PREDICT_CXX
+
+#include "error_predict.hxx"
+
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+/* log of the k-th Catalan number, C_k = (2k)! / (k! (k+1)!) */
+static double log_catalan(long long k)
+{
+	return lgamma(2.0*k + 1) - lgamma(k + 1.0) - lgamma(k + 2.0);
+}
+
+double subtree_prob(long long n, long long m)
+{
+	if (m < 1 || m > n) {
+		return 0.0;
+	}
+	return exp(log_catalan(m-1) + log_catalan(n-m) - log_catalan(n-1));
+}
+
+/* In-place iterative radix-2 FFT. len(a) must be a power of two. */
+static void fft(vector<complex<double> > &a, bool invert)
+{
+	size_t n = a.size();
+	size_t i, j, k, len;
+	for (i = 1, j = 0; i < n; i++) {
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			swap(a[i], a[j]);
+		}
+	}
+	for (len = 2; len <= n; len <<= 1) {
+		double ang = 2 * M_PI / len * (invert ? -1 : 1);
+		complex<double> wl(cos(ang), sin(ang));
+		for (i = 0; i < n; i += len) {
+			complex<double> w(1.0);
+			for (k = 0; k < len / 2; k++) {
+				complex<double> s = a[i+k];
+				complex<double> t = a[i+k+len/2] * w;
+				a[i+k] = s + t;
+				a[i+k+len/2] = s - t;
+				w *= wl;
+			}
+		}
+	}
+	if (invert) {
+		for (i = 0; i < n; i++) {
+			a[i] /= (double) n;
+		}
+	}
+}
+
+/* r[m] = sum_{i=0}^{len-1-m} p[i] p[i+m] for m = 0..len-1 */
+static vector<double> autocorrelation(const vector<double> &p)
+{
+	size_t len = p.size();
+	size_t sz = 1;
+	while (sz < 2 * len) {
+		sz <<= 1;
+	}
+	vector<complex<double> > f(sz, 0.0);
+	for (size_t i = 0; i < len; i++) {
+		f[i] = p[i];
+	}
+	fft(f, false);
+	for (size_t i = 0; i < sz; i++) {
+		f[i] = f[i] * conj(f[i]);
+	}
+	fft(f, true);
+	vector<double> r(len);
+	for (size_t m = 0; m < len; m++) {
+		r[m] = f[m].real();
+	}
+	return r;
+}
+
+static err_moments_t moments(long double sum_sq, double dvar)
+{
+	err_moments_t e;
+	e.mean = 0.0;
+	e.sum_sq = (double) sum_sq;
+	e.var = (double) (sum_sq * dvar);
+	return e;
+}
+
+/* E[S_m^2] where S_m is the sum of m values drawn without replacement */
+static long double perm_sum_sq(long long n, long long m, long double s1, long double s2)
+{
+	long double a = s2 / n;
+	long double b = n > 1 ? (s1 * s1 - s2) / ((long double) n * (n - 1)) : 0.0;
+	return m * a + (long double) m * (m - 1) * b;
+}
+
+err_moments_t predict_sum_error(long long n, const double *x,
+                                assoc_order_t order, double dvar)
+{
+	long long i, m;
+	long double s1 = 0.0, s2 = 0.0, acc = 0.0;
+	if (n <= 0) {
+		fprintf(stderr, "predict_sum_error: n must be positive (%lld)\n", n);
+		throw PREDICT_EXCEPTION;
+	}
+	for (i = 0; i < n; i++) {
+		s1 += x[i];
+		s2 += (long double) x[i] * x[i];
+	}
+
+	switch (order) {
+	case LEFT_ASSOC:
+		/* Partial sums x_0 + ... + x_{k-1} for k = 2..n */
+		{
+			long double p = x[0];
+			for (i = 1; i < n; i++) {
+				p += x[i];
+				acc += p * p;
+			}
+		}
+		break;
+	case SHUFFLE_LEFT_ASSOC:
+		for (m = 2; m <= n; m++) {
+			acc += perm_sum_sq(n, m, s1, s2);
+		}
+		break;
+	case SHUFFLE_RANDOM_ASSOC:
+		for (m = 2; m <= n; m++) {
+			acc += subtree_prob(n, m) * (n - m + 1) * perm_sum_sq(n, m, s1, s2);
+		}
+		break;
+	case RANDOM_ASSOC:
+		/* Center the data so the FFT works on a bridge rather than a drift,
+		 * then put the mean back in analytically:
+		 *   S_{i,m} = m*mu + (py[i+m] - py[i]) */
+		{
+			long double mu = s1 / n;
+			vector<double> py(n + 1);
+			vector<long double> a(n + 2), b(n + 2); // prefix sums of py, py^2
+			long double run = 0.0;
+			py[0] = 0.0;
+			for (i = 0; i < n; i++) {
+				run += x[i] - mu;
+				py[i+1] = (double) run;
+			}
+			a[0] = b[0] = 0.0;
+			for (i = 0; i <= n; i++) {
+				a[i+1] = a[i] + py[i];
+				b[i+1] = b[i] + (long double) py[i] * py[i];
+			}
+			vector<double> r = autocorrelation(py);
+			for (m = 2; m <= n; m++) {
+				long long w = n - m + 1; // Number of windows of width m
+				long double lin = (a[n+1] - a[m]) - a[w];
+				long double quad = (b[n+1] - b[m]) + b[w] - 2.0 * r[m];
+				long double q = w * mu * mu * m * m + 2.0 * m * mu * lin + quad;
+				acc += subtree_prob(n, m) * q;
+			}
+		}
+		break;
+	default:
+		fprintf(stderr, "predict_sum_error: unknown order %d\n", (int) order);
+		throw PREDICT_EXCEPTION;
+	}
+	return moments(acc, dvar);
+}
+
+err_moments_t predict_sum_error_iid(long long n, double mu, double sigma2,
+                                    assoc_order_t order, double dvar)
+{
+	long long m;
+	long double acc = 0.0;
+	if (n <= 0) {
+		fprintf(stderr, "predict_sum_error_iid: n must be positive (%lld)\n", n);
+		throw PREDICT_EXCEPTION;
+	}
+	/* For iid data shuffling changes nothing, E[S_m^2] = m sigma^2 + m^2 mu^2 */
+	for (m = 2; m <= n; m++) {
+		long double esq = m * (long double) sigma2 + (long double) m * m * mu * mu;
+		switch (order) {
+		case LEFT_ASSOC:
+		case SHUFFLE_LEFT_ASSOC:
+			acc += esq;
+			break;
+		case RANDOM_ASSOC:
+		case SHUFFLE_RANDOM_ASSOC:
+			acc += subtree_prob(n, m) * (n - m + 1) * esq;
+			break;
+		default:
+			fprintf(stderr, "predict_sum_error_iid: unknown order %d\n", (int) order);
+			throw PREDICT_EXCEPTION;
+		}
+	}
+	return moments(acc, dvar);
+}
+
+double chebyshev_tail(err_moments_t m, double p)
+{
+	return sqrt(m.var / p);
+}
+
+double normal_tail(err_moments_t m, double p)
+{
+	/* Solve erfc(z / sqrt(2)) = p by bisection; erfc is decreasing */
+	double lo = 0.0, hi = 40.0, z;
+	for (int i = 0; i < 200; i++) {
+		z = (lo + hi) / 2;
+		if (erfc(z / M_SQRT2) > p) {
+			lo = z;
+		} else {
+			hi = z;
+		}
+	}
+	return lo * sqrt(m.var);
+}
+
+#endif
@@ -0,0 +1,72 @@
+/* Probabilistic prediction of summation error over random associations.
+ * Where error_semantics gives worst-case bounds, this gives the moments of the
+ * error over the association trees sampled by random_reduction_tree (and over
+ * random shuffles of the input), so Monte Carlo runs of assoc_test can be
+ * checked against a prediction instead of being the only source of numbers.
+ *
+ * Model: each addition fl(a+b) = (a+b)(1+d) where the d are independent,
+ * mean zero, with variance dvar (u^2/3 if d is uniform on [-u,u], u the unit
+ * roundoff). To first order the error of a tree is sum_v d_v S_v over inner
+ * nodes v, where S_v is the exact sum of the leaves below v. Then
+ *     E[err] = 0,    Var[err] = dvar * E_tree[ sum_v S_v^2 ].
+ * The true d depend on where S_v falls in its binade and are slightly biased,
+ * so expect agreement with trials to within a small factor; dvar can be
+ * calibrated from a short assoc_test run.
+ *
+ * A uniformly random binary tree on n leaves (Algorithm R) contains the
+ * contiguous run of leaves i..i+m-1 as a subtree with probability
+ *     P(m) = C_{m-1} C_{n-m} / C_{n-1}     (C_k is the k-th Catalan number)
+ * independent of i, so E_tree[sum_v S_v^2] = sum_m P(m) sum_i S_{i,m}^2.
+ * The inner sum over i is found for every m at once with an FFT, which
+ * makes the data-driven prediction O(n log n); the iid prediction is O(n).
+ */
+#ifndef ERROR_PREDICT_HXX
+#define ERROR_PREDICT_HXX
+
+#include <limits>
+
+#define PREDICT_EXCEPTION 5
+
+/* Orders, named as in the output of assoc_test */
+typedef enum assoc_order {
+	LEFT_ASSOC,           // "Left assoc"
+	RANDOM_ASSOC,         // "Random assoc"
+	SHUFFLE_LEFT_ASSOC,   // "Shuffle l assoc"
+	SHUFFLE_RANDOM_ASSOC  // "Shuffle rand assoc"
+} assoc_order_t;
+
+/* Moments of the absolute error fl(sum) - sum */
+typedef struct err_moments {
+	double mean;     // Expected error
+	double var;      // Variance of the error
+	double sum_sq;   // E[sum_v S_v^2], the unscaled second moment
+} err_moments_t;
+
+/* Variance of the relative rounding error d under round-to-nearest, taking d
+ * uniform on [-u,u] with u half of machine epsilon */
+template <typename FLOAT_T>
+double rounding_var()
+{
+	double u = std::numeric_limits<FLOAT_T>::epsilon() / 2.0;
+	return u * u / 3.0;
+}
+
+/* Probability that a fixed run of m consecutive leaves forms a subtree of a
+ * uniformly random binary tree with n leaves */
+double subtree_prob(long long n, long long m);
+
+/* Prediction from the values actually being summed, O(n log n) */
+err_moments_t predict_sum_error(long long n, const double *x,
+                                assoc_order_t order, double dvar);
+
+/* Prediction for n iid values with mean mu and variance sigma2, O(n) */
+err_moments_t predict_sum_error_iid(long long n, double mu, double sigma2,
+                                    assoc_order_t order, double dvar);
+
+/* Chebyshev tail bound: P(|err - mean| >= t) <= p. Returns t. */
+double chebyshev_tail(err_moments_t m, double p);
+
+/* Normal approximation: |err - mean| < t with probability 1 - p. Returns t. */
+double normal_tail(err_moments_t m, double p);
+
+#endif
@@ -28,19 +28,19 @@ Scal_E<FLOAT_T, MPFR_T>::Scal_E(FLOAT_T lb, FLOAT_T ub, MPFR_T err)
 }
 
 template <class FLOAT_T, class MPFR_T>
-long long Scal_E<FLOAT_T, MPFR_T>::length() { return 1LL; }
+long long Scal_E<FLOAT_T, MPFR_T>::length() const { return 1LL; }
 
 template <class FLOAT_T, class MPFR_T>
-FLOAT_T Scal_E<FLOAT_T, MPFR_T>::lb() { return lb_; }
+FLOAT_T Scal_E<FLOAT_T, MPFR_T>::lb() const { return lb_; }
 
 template <class FLOAT_T, class MPFR_T>
-FLOAT_T Scal_E<FLOAT_T, MPFR_T>::ub() { return ub_; }
+FLOAT_T Scal_E<FLOAT_T, MPFR_T>::ub() const { return ub_; }
 
 template <class FLOAT_T, class MPFR_T>
-MPFR_T Scal_E<FLOAT_T, MPFR_T>::error_lb() { return error_lb_; }
+MPFR_T Scal_E<FLOAT_T, MPFR_T>::error_lb() const { return error_lb_; }
 
 template <class FLOAT_T, class MPFR_T>
-MPFR_T Scal_E<FLOAT_T, MPFR_T>::error_ub() { return error_ub_; }
+MPFR_T Scal_E<FLOAT_T, MPFR_T>::error_ub() const { return error_ub_; }
 
 /* Vectors */
 template <class FLOAT_T, class MPFR_T>
@@ -55,10 +55,7 @@ Vec_E<FLOAT_T, MPFR_T>::Vec_E(
 	FLOAT_T *x, long long n, FLOAT_T lb, FLOAT_T ub, MPFR_T err)
 	: n_(n), lb_(lb), ub_(ub), error_lb_(-err), error_ub_(err)
 {
-	data_.reserve(n);
-	for (long long i = 0; i < n; i++) {
-		data_[i] = x[i];
-	}
+	data_.assign(x, x + n);
 	inf_norm_ = std::max(abs(lb),abs(ub));
 }
 
@@ -72,92 +69,63 @@ Vec_E<FLOAT_T, MPFR_T>::Vec_E(
 }
 
 template <class FLOAT_T, class MPFR_T>
-long long Vec_E<FLOAT_T, MPFR_T>::length() { return n_; };
+long long Vec_E<FLOAT_T, MPFR_T>::length() const { return n_; };
 
 template <class FLOAT_T, class MPFR_T>
-FLOAT_T Vec_E<FLOAT_T, MPFR_T>::lb() { return lb_; }
+FLOAT_T Vec_E<FLOAT_T, MPFR_T>::lb() const { return lb_; }
 
 template <class FLOAT_T, class MPFR_T>
-FLOAT_T Vec_E<FLOAT_T, MPFR_T>::ub() { return ub_; }
+FLOAT_T Vec_E<FLOAT_T, MPFR_T>::ub() const { return ub_; }
 
 template <class FLOAT_T, class MPFR_T>
-MPFR_T Vec_E<FLOAT_T, MPFR_T>::error_lb() { return error_lb_; }
+MPFR_T Vec_E<FLOAT_T, MPFR_T>::error_lb() const { return error_lb_; }
 
 template <class FLOAT_T, class MPFR_T>
-MPFR_T Vec_E<FLOAT_T, MPFR_T>::error_ub() { return error_ub_; }
+MPFR_T Vec_E<FLOAT_T, MPFR_T>::error_ub() const { return error_ub_; }
 
 /* Vector operations */
-MPFR_T_DEFAULT gamma(const std::type_info& float_t, long long int n)
+template <typename FLOAT_T>
+MPFR_T_DEFAULT gamma(long long int n)
 {
-	MPFR_T_DEFAULT eps;
-	if (float_t == typeid(double)) {
-		eps = mach_eps<double>;
-	} else if (float_t == typeid(float)) {
-		eps = mach_eps<float>;
-	} else {
-		std::cerr << "gamma: unsupported floating-point type "
-			<< float_t.name() << std::endl;
-		throw(ANALYSIS_EXCEPTION);
-	}
+	MPFR_T_DEFAULT eps = mach_eps<FLOAT_T>;
 	return n * eps / (1.0 - n * eps);
 }
 
 template <typename FLOAT_T>
-Scal_E<FLOAT_T> dot_e(Vec_E<FLOAT_T> x, Vec_E<FLOAT_T> y)
+Scal_E<FLOAT_T> dot_e(const Vec_E<FLOAT_T> &x, const Vec_E<FLOAT_T> &y)
 {
 	/* TODO: Allow for different floating-point types in return-value and input. */
 	long long n = x.length();
 	assert(x.length() == y.length());
-	/* Weirdness cause I couldn't get the template to work, see mach_del_dbl in .hxx */
-	MPFR_T_DEFAULT mach_del;
-	if (typeid(FLOAT_T) == typeid(double)) {
-		mach_del = mach_del_dbl;
-	} else if (typeid(FLOAT_T) == typeid(float)) {
-		mach_del = mach_del_flt;
-	} else {
-		std::cerr << "dot_e: unsupported type "
-			<< typeid(FLOAT_T).name() << std::endl;
-		throw(ANALYSIS_EXCEPTION);
-	}
 	MPFR_T_DEFAULT err, subn;
 	/* Calculate lower/upper bounds for x,y, absolute and regular */
-	FLOAT_T lb, ub, abs_lb, x_mag, y_mag;
-	std::vector<FLOAT_T> range = std::vector<FLOAT_T>(4);
-	std::vector<FLOAT_T> abs_range = std::vector<FLOAT_T>(8);
-	range[0] = x.lb() * y.lb();
-	range[1] = x.lb() * y.ub();
-	range[2] = x.ub() * y.lb();
-	range[3] = x.ub() * y.ub();
-	lb = *std::min_element(range.begin(), range.end());
-	ub = *std::max_element(range.begin(), range.end());
-	abs_range[0] = abs(x.lb()*x.lb());
-	abs_range[1] = abs(x.ub()*x.ub());
-	abs_range[2] = abs(y.lb()*y.lb());
-	abs_range[3] = abs(y.ub()*y.ub());
-	abs_range[4] = abs(x.lb()*y.lb());
-	abs_range[5] = abs(x.ub()*y.ub());
-	abs_range[6] = abs(x.lb()*y.ub());
-	abs_range[7] = abs(y.ub()*y.lb());
-	x_mag = fmax(x.lb(), x.ub());
-	y_mag = fmax(y.lb(), y.ub());
-	abs_lb = *std::min_element(abs_range.begin(), abs_range.end());
+	FLOAT_T lb, ub, x_mag, y_mag, x_min, y_min;
+	lb = std::min({x.lb() * y.lb(), x.lb() * y.ub(), x.ub() * y.lb(), x.ub() * y.ub()});
+	ub = std::max({x.lb() * y.lb(), x.lb() * y.ub(), x.ub() * y.lb(), x.ub() * y.ub()});
+	x_mag = std::max(abs(x.lb()), abs(x.ub()));
+	y_mag = std::max(abs(y.lb()), abs(y.ub()));
+	/* Smallest possible |x_i| and |y_i| */
+	x_min = (x.lb() <= 0 && x.ub() >= 0) ? 0 : std::min(abs(x.lb()), abs(x.ub()));
+	y_min = (y.lb() <= 0 && y.ub() >= 0) ? 0 : std::min(abs(y.lb()), abs(y.ub()));
 
 	/* Check if subnormal numbers are possible */
 	subn = 0.0;
-	if (abs_lb < std::numeric_limits<FLOAT_T>::min()) {
-		subn = n * mach_del * (1.0 + gamma(typeid(FLOAT_T), n-1));
+	if (x_min * y_min < std::numeric_limits<FLOAT_T>::min()) {
+		subn = n * mach_del<FLOAT_T> * (1.0 + gamma<FLOAT_T>(n-1));
 	}
 
-	/*  e * |x| . |y| * \gamma_n + nd(1 + \theta_{n-1}) */
-	err = x.error_ub() + y.error_ub()
-		+ x_mag * y_mag * n * gamma(typeid(FLOAT_T), n)
+	/* Error in the inputs: n (|dx| |y| + |dy| |x| + |dx| |dy|), plus
+	 * e * |x| . |y| * \gamma_n + nd(1 + \theta_{n-1}) */
+	err = n * (x.error_ub() * y_mag + y.error_ub() * x_mag
+			+ x.error_ub() * y.error_ub())
+		+ x_mag * y_mag * n * gamma<FLOAT_T>(n)
 		+ subn;
 	return Scal_E<FLOAT_T>(n * lb, n * ub, err);
 }
 
 /* TODO: Fix */
 template <typename FLOAT_T>
-Scal_E<FLOAT_T> sqrt_e(Scal_E<FLOAT_T> x)
+Scal_E<FLOAT_T> sqrt_e(const Scal_E<FLOAT_T> &x)
 {
 	MPFR_T_DEFAULT eps = mach_eps<FLOAT_T>;
 	MPFR_T_DEFAULT one = 1.0;
@@ -168,7 +136,7 @@ Scal_E<FLOAT_T> sqrt_e(Scal_E<FLOAT_T> x)
 
 /* TODO: Fix */
 template <typename FLOAT_T>
-Scal_E<FLOAT_T> inv_e(Scal_E<FLOAT_T> x)
+Scal_E<FLOAT_T> inv_e(const Scal_E<FLOAT_T> &x)
 {
 	MPFR_T_DEFAULT eps = mach_eps<FLOAT_T>;
 	MPFR_T_DEFAULT one = 1.0;
@@ -182,10 +150,12 @@ template class Vec_E< double, mpfr_float_1000 >;
 template class Vec_E< float, mpfr_float_1000 >;
 template class Scal_E< double, mpfr_float_1000 >;
 template class Scal_E< float, mpfr_float_1000 >;
-template Scal_E<float> dot_e(Vec_E<float> x, Vec_E<float> y);
-template Scal_E<double> dot_e(Vec_E<double> x, Vec_E<double> y);
-template Scal_E<float> sqrt_e(Scal_E<float> x);
-template Scal_E<double> sqrt_e(Scal_E<double> x);
-template Scal_E<float> inv_e(Scal_E<float> x);
-template Scal_E<double> inv_e(Scal_E<double> x);
+template MPFR_T_DEFAULT gamma<float>(long long int n);
+template MPFR_T_DEFAULT gamma<double>(long long int n);
+template Scal_E<float> dot_e(const Vec_E<float> &x, const Vec_E<float> &y);
+template Scal_E<double> dot_e(const Vec_E<double> &x, const Vec_E<double> &y);
+template Scal_E<float> sqrt_e(const Scal_E<float> &x);
+template Scal_E<double> sqrt_e(const Scal_E<double> &x);
+template Scal_E<float> inv_e(const Scal_E<float> &x);
+template Scal_E<double> inv_e(const Scal_E<double> &x);
 #endif
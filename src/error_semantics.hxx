@@ -1,5 +1,7 @@
 /* Semantics of floating-point error.
  * Given an operation, return the error bounds.
+ * These are computed in MPFR and serve as the reference for the fast
+ * double-precision bounds in error_bounds.hxx.
  */
 #ifndef ERROR_SEMANTICS_HXX
 #define ERROR_SEMANTICS_HXX
@@ -7,7 +9,6 @@
 #include <algorithm>
 #include <complex>
 #include <limits>
-#include <typeinfo>
 #include <vector>
 #include <assert.h>
 #include <boost/multiprecision/mpfr.hpp>
@@ -35,11 +36,12 @@ const MPFR_T_DEFAULT mach_eps_dbl = mach_eps<double>;
  * - machine epsilon for complex
  * - machine delta for complex
  */
-/* TODO: Figure out a better way to do this. Maybe FLT_TRUE_MIN ? */
-const MPFR_T_DEFAULT mach_del_flt =
-	pow(2, std::numeric_limits<float>::min_exponent - 1)*mach_eps<float>;
-const MPFR_T_DEFAULT mach_del_dbl =
-	pow(2, std::numeric_limits<double>::min_exponent - 1)*mach_eps<double>;
+/* Smallest subnormal, i.e. FLT_TRUE_MIN or DBL_TRUE_MIN */
+template <typename FLOAT_T>
+const MPFR_T_DEFAULT mach_del = std::numeric_limits<FLOAT_T>::denorm_min();
+
+const MPFR_T_DEFAULT mach_del_flt = mach_del<float>;
+const MPFR_T_DEFAULT mach_del_dbl = mach_del<double>;
 
 template <class FLOAT_T, class MPFR_T = MPFR_T_DEFAULT >
 class Scal_E {
@@ -52,11 +54,11 @@ class Scal_E {
 		Scal_E(FLOAT_T lb, FLOAT_T ub, MPFR_T err);
 		// Destructor
 		~Scal_E();
-		long long length();
-		FLOAT_T lb();
-		FLOAT_T ub();
-		MPFR_T error_lb();
-		MPFR_T error_ub();
+		long long length() const;
+		FLOAT_T lb() const;
+		FLOAT_T ub() const;
+		MPFR_T error_lb() const;
+		MPFR_T error_ub() const;
 	private:
 		FLOAT_T data_;
 		FLOAT_T lb_;
@@ -79,11 +81,11 @@ class Vec_E {
 		Vec_E(long long n, FLOAT_T lb, FLOAT_T ub, MPFR_T err);
 		// Destructor
 		~Vec_E();
-		long long length();
-		FLOAT_T lb();
-		FLOAT_T ub();
-		MPFR_T error_lb();
-		MPFR_T error_ub();
+		long long length() const;
+		FLOAT_T lb() const;
+		FLOAT_T ub() const;
+		MPFR_T error_lb() const;
+		MPFR_T error_ub() const;
 	private:
 		std::vector<FLOAT_T> data_;
 		long long n_;
@@ -94,18 +96,22 @@ class Vec_E {
 		MPFR_T inf_norm_;
 };
 
+/* n eps / (1 - n eps) */
+template <typename FLOAT_T>
+MPFR_T_DEFAULT gamma(long long int n);
+
 /* Operations on vectors */
 /* Error bounds of dot product */
 template <typename FLOAT_T>
-Scal_E<FLOAT_T> dot_e(Vec_E<FLOAT_T> x, Vec_E<FLOAT_T> y);
+Scal_E<FLOAT_T> dot_e(const Vec_E<FLOAT_T> &x, const Vec_E<FLOAT_T> &y);
 
 /* Operations on Scalars */
 /* Error of sqrt of scalars */
 template <typename FLOAT_T>
-Scal_E<FLOAT_T> sqrt_e(Scal_E<FLOAT_T> x);
+Scal_E<FLOAT_T> sqrt_e(const Scal_E<FLOAT_T> &x);
 
 /* Error of inverse of scalar (1.0/x) */
 template <typename FLOAT_T>
-Scal_E<FLOAT_T> inv_e(Scal_E<FLOAT_T> x);
+Scal_E<FLOAT_T> inv_e(const Scal_E<FLOAT_T> &x);
 
 #endif
@@ -2,26 +2,174 @@
 #define GEN_RANDOM_CXX
 
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <vector>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "rand.hxx"
+#include "vec_map.hxx"
 
-#define USAGE ("gen_random <n> <distr> where\n"\
+#define USAGE ("gen_random <n> <distr> [<format> <file> [<seed>]] where\n"\
                "<n> is the number of elements to generate\n"\
                "<distr> is the distribution to use. Choices are:\n"\
-               "\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n")
+               "\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n"\
+               "<format> is text (the default: a line with <distr>, then %a per line),\n"\
+               "\tor f64 or f32 for raw binary, which assoc_test and dotprod_mpi read\n"\
+               "\tas f64:<file>. Binary formats take the suffixes +header, to start\n"\
+               "\twith the header of vec_map.hxx, and +direct, to write with O_DIRECT\n"\
+               "<file> is where to write, - for standard output\n"\
+               "<seed> defaults to 42. Elements come in blocks of 65536, generated in\n"\
+               "\tparallel, block b from seeds derived from (<seed>, b). With\n"\
+               "\tGEN_SERIAL=1 they are instead the one stream of set_seed(<seed>, 0)\n"\
+               "\tthat assoc_test uses, generated serially, as gen_random wrote before\n")
 
-#define FLOAT_T double
+/* Elements per seeded block. Changing it changes every file. */
+#define GEN_BLOCK (1 << 16)
+/* Blocks generated per thread between writes */
+#define GEN_BATCH 4
+/* Alignment of buffers, lengths and offsets for O_DIRECT */
+#define GEN_ALIGN 4096
 
-int main (int argc, char* argv[])
+/* Seeds of block b, or with serial the state where the previous block left
+ * the stream of set_seed(seed, 0), which starts in stream. That stream has
+ * a zero half (i2 = 0), so it is only used when asked for: every block
+ * having its own full rand_stream keeps the statistics the same all
+ * through a file. */
+static rand_state_t block_seed(unsigned int seed, long long b, bool serial, rand_state_t stream)
+{
+	return serial ? stream : rand_stream(seed, (unsigned long long) b);
+}
+
+/* Write all of buf, retrying short writes. 0 on success. */
+static int write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t w;
+	while (len > 0) {
+		w = write(fd, buf, len);
+		if (w < 0 && errno == EINTR) {
+			continue;
+		}
+		if (w <= 0) {
+			return 1;
+		}
+		buf += w;
+		len -= (size_t) w;
+	}
+	return 0;
+}
+
+/* O_DIRECT needs aligned lengths, so the tail of the file is written
+ * through the page cache */
+static int write_out(int fd, const char *buf, size_t len, bool direct)
 {
-	FLOAT_T (*rand_flt)(); // Function to generate a random float
-	FLOAT_T mag;
-	long long len, i;
+	size_t head = direct ? len - len % GEN_ALIGN : len;
+	if (write_all(fd, buf, head) != 0) {
+		return 1;
+	}
+	if (head == len) {
+		return 0;
+	}
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT) != 0) {
+		return 1;
+	}
+	return write_all(fd, buf + head, len - head);
+}
+
+template <typename T>
+static int write_binary(int fd, bool direct, long long len, unsigned int seed, bool serial,
+                        double (*rand_flt)(rand_state_t *), int threads)
+{
+	rand_state_t stream = {seed, 0};
+	long long nblocks = (len + GEN_BLOCK - 1) / GEN_BLOCK, first, nb, k;
+	size_t batch = (size_t) threads * GEN_BATCH * GEN_BLOCK * sizeof(T);
+	void *mem;
+	T *buf;
 	int rc = 0;
 
-	if (argc != 3) {
+	if (posix_memalign(&mem, GEN_ALIGN, batch) != 0) {
+		return 1;
+	}
+	buf = (T *) mem;
+	for (first = 0; first < nblocks && rc == 0; first += nb) {
+		nb = std::min((long long) threads * GEN_BATCH, nblocks - first);
+		#pragma omp parallel for schedule(static) if(!serial)
+		for (k = 0; k < nb; k++) {
+			rand_state_t s = block_seed(seed, first + k, serial, stream);
+			long long n = std::min((long long) GEN_BLOCK, len - (first + k) * GEN_BLOCK);
+			T *out = buf + k * GEN_BLOCK;
+			for (long long i = 0; i < n; i++) {
+				out[i] = (T) rand_flt(&s);
+			}
+			if (serial) {
+				stream = s;
+			}
+		}
+		rc = write_out(fd, (const char *) buf,
+		               (size_t) (std::min(len, (first + nb) * GEN_BLOCK) - first * GEN_BLOCK) * sizeof(T),
+		               direct);
+	}
+	free(mem);
+	return rc;
+}
+
+static int write_text(int fd, long long len, unsigned int seed, bool serial, const std::string &dist,
+                      double (*rand_flt)(rand_state_t *), int threads)
+{
+	rand_state_t stream = {seed, 0};
+	long long nblocks = (len + GEN_BLOCK - 1) / GEN_BLOCK, first, nb, k;
+	std::vector<std::string> text(threads * GEN_BATCH);
+	std::string line = dist + "\n";
+
+	if (write_all(fd, line.data(), line.size()) != 0) {
+		return 1;
+	}
+	for (first = 0; first < nblocks; first += nb) {
+		nb = std::min((long long) threads * GEN_BATCH, nblocks - first);
+		#pragma omp parallel for schedule(static) if(!serial)
+		for (k = 0; k < nb; k++) {
+			rand_state_t s = block_seed(seed, first + k, serial, stream);
+			long long n = std::min((long long) GEN_BLOCK, len - (first + k) * GEN_BLOCK);
+			char num[40];
+			text[k].clear();
+			for (long long i = 0; i < n; i++) {
+				text[k].append(num, snprintf(num, sizeof(num), "%a\n", rand_flt(&s)));
+			}
+			if (serial) {
+				stream = s;
+			}
+		}
+		for (k = 0; k < nb; k++) {
+			if (write_all(fd, text[k].data(), text[k].size()) != 0) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+int main (int argc, char* argv[])
+{
+	double (*rand_flt)(rand_state_t *); // Function to generate a random float
+	long long len;
+	int rc = 0, fd = 1, flags, threads = 1;
+	unsigned int seed = ASSOC_SEED;
+	bool header = false, direct = false;
+	const char *serial_env = getenv("GEN_SERIAL");
+	bool serial = serial_env != NULL && atoi(serial_env) != 0;
+	std::string format = "text", file = "-", base;
+	size_t plus;
+
+	if (argc != 3 && argc != 5 && argc != 6) {
 		fprintf(stderr, "Wrong argc\n%s", USAGE);
 		return 1;
 	}
@@ -31,17 +179,87 @@ int main (int argc, char* argv[])
 		return 1;
 	}
 	std::string dist = argv[2];
-	rc = parse_distr<FLOAT_T>(dist, &mag, &rand_flt);
+	rc = parse_distr_r(dist, &rand_flt);
 	if (rc != 0) {
 		fprintf(stderr, "Unrecognized distribution:\n%s", USAGE);
 		return 1;
 	}
-	set_seed(ASSOC_SEED, 0);
-	srand(ASSOC_SEED);
+	if (argc >= 5) {
+		format = argv[3];
+		file = argv[4];
+	}
+	if (argc == 6) {
+		seed = (unsigned int) strtoul(argv[5], NULL, 10);
+	}
+	plus = format.find('+');
+	base = format.substr(0, plus);
+	while (plus != std::string::npos) {
+		size_t next = format.find('+', plus + 1);
+		std::string mod = format.substr(plus + 1, next == std::string::npos ? next : next - plus - 1);
+		if (mod == "header") {
+			header = true;
+		} else if (mod == "direct") {
+			direct = true;
+		} else {
+			base = "";
+		}
+		plus = next;
+	}
+	if ((base != "text" && base != "f64" && base != "f32") || (base == "text" && (header || direct))) {
+		fprintf(stderr, "Unrecognized format %s\n%s", format.c_str(), USAGE);
+		return 1;
+	}
+#ifdef _OPENMP
+	threads = omp_get_max_threads();
+#endif
 
-	printf("%s\n",dist.c_str());
-	for (i = 0; i < len; i++) {
-		printf("%a\n", rand_flt());
+	if (file != "-") {
+		flags = O_WRONLY | O_CREAT | O_TRUNC;
+		fd = open(file.c_str(), flags | (direct ? O_DIRECT : 0), 0644);
+		if (fd < 0 && direct && errno == EINVAL) {
+			/* tmpfs and some others refuse O_DIRECT */
+			fprintf(stderr, "%s does not support O_DIRECT, writing through the page cache\n",
+				file.c_str());
+			direct = false;
+			fd = open(file.c_str(), flags, 0644);
+		}
+		if (fd < 0) {
+			fprintf(stderr, "Could not open %s: %s\n", file.c_str(), strerror(errno));
+			return 1;
+		}
+	} else {
+		direct = false;
+	}
+
+	if (header) {
+		vec_header_t h;
+		void *p;
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, VEC_MAGIC, sizeof(VEC_MAGIC));
+		h.version = VEC_VERSION;
+		h.elem_size = base == "f64" ? sizeof(double) : sizeof(float);
+		h.n = (uint64_t) len;
+		h.seed = seed;
+		h.block = serial ? 0 : GEN_BLOCK;
+		h.little_endian = vec_little_endian();
+		strncpy(h.distr, dist.c_str(), sizeof(h.distr) - 1);
+		rc = posix_memalign(&p, GEN_ALIGN, VEC_HEADER_BYTES);
+		if (rc == 0) {
+			vec_header_pack(h, (unsigned char *) p);
+			rc = write_out(fd, (const char *) p, VEC_HEADER_BYTES, direct);
+			free(p);
+		}
+	}
+	if (rc == 0 && base == "f64") {
+		rc = write_binary<double>(fd, direct, len, seed, serial, rand_flt, threads);
+	} else if (rc == 0 && base == "f32") {
+		rc = write_binary<float>(fd, direct, len, seed, serial, rand_flt, threads);
+	} else if (rc == 0) {
+		rc = write_text(fd, len, seed, serial, dist, rand_flt, threads);
+	}
+	if ((fd != 1 && close(fd) != 0) || rc != 0) {
+		fprintf(stderr, "Could not write %s: %s\n", file.c_str(), strerror(errno));
+		return 1;
 	}
 	return 0;
 }
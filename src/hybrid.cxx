@@ -0,0 +1,123 @@
+/* Intra-node reductions with threads. See hybrid.hxx */
+#include <chrono>
+#include <cmath>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "hybrid.hxx"
+
+/* Thread partials are this many doubles apart, so no two share a cache line */
+#define PAD 8
+
+static double now()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double dot_range(const double *a, const double *b, long long lo, long long hi)
+{
+	double acc = 0.0;
+	for (long long i = lo; i < hi; i++) {
+		acc += a[i] * b[i];
+	}
+	return acc;
+}
+
+int parse_intra(std::string description, intra_tree_t *how)
+{
+	if (description == "fixed") {
+		*how = INTRA_FIXED;
+	} else if (description == "omp") {
+		*how = INTRA_OMP;
+	} else if (description == "tree") {
+		*how = INTRA_TREE;
+	} else {
+		return 1;
+	}
+	return 0;
+}
+
+int intra_threads()
+{
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+intra_result_t intra_dot(const double *a, const double *b, long long n, intra_tree_t how)
+{
+	intra_result_t r;
+	int nt = intra_threads();
+	std::vector<double> partial(nt * PAD, 0.0);
+	double t0, t1 = 0.0, t2, s = 0.0;
+
+	r.threads = nt;
+	r.height = -1;
+	t0 = now();
+	if (how == INTRA_OMP) {
+		#ifdef _OPENMP
+		#pragma omp parallel for reduction(+:s) schedule(static)
+		#endif
+		for (long long i = 0; i < n; i++) {
+			s += a[i] * b[i];
+		}
+		r.sum = s;
+		r.compute_time = now() - t0;
+		r.combine_time = nan("");
+		return r;
+	}
+
+	/* The team can still be smaller than nt (OMP_DYNAMIC, thread limits,
+	 * nesting), so the slices are of the team actually running */
+	#ifdef _OPENMP
+	#pragma omp parallel num_threads(nt)
+	#endif
+	{
+#ifdef _OPENMP
+		int t = omp_get_thread_num(), m = omp_get_num_threads();
+#else
+		int t = 0, m = 1;
+#endif
+		partial[t * PAD] = dot_range(a, b, n * t / m, n * (t + 1) / m);
+		if (t == 0) {
+			r.threads = m;
+		}
+		if (how == INTRA_TREE) {
+			#ifdef _OPENMP
+			#pragma omp barrier
+			#pragma omp master
+			#endif
+			t1 = now();
+			for (int stride = 1; stride < m; stride *= 2) {
+				if (t % (2 * stride) == 0 && t + stride < m) {
+					partial[t * PAD] = partial[t * PAD] + partial[(t + stride) * PAD];
+				}
+				#ifdef _OPENMP
+				#pragma omp barrier
+				#endif
+			}
+		}
+	}
+	nt = r.threads;
+	if (how == INTRA_TREE) {
+		t2 = now();
+		r.sum = partial[0];
+		r.height = (long long) ceil(log2(nt));
+	} else {
+		t1 = now();
+		for (int t = 0; t < nt; t++) {
+			s += partial[t * PAD];
+		}
+		t2 = now();
+		r.sum = s;
+		r.height = nt - 1;
+	}
+	r.compute_time = t1 - t0;
+	r.combine_time = t2 - t1;
+	return r;
+}
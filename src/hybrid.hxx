@@ -0,0 +1,38 @@
+/* Dot products on one node with threads, for the hybrid variants of
+ * dotprod_mpi. Each thread takes a contiguous piece of the rank's chunk, and
+ * the thread partials are combined by one of
+ * - INTRA_FIXED: thread 0 adds them in thread order after all are done,
+ * - INTRA_OMP:   OpenMP reduction(+), in whatever order the runtime picks,
+ * - INTRA_TREE:  a binary tree among the threads, thread t adding in thread
+ *                t + stride, with a barrier per level and no atomics.
+ * FIXED and TREE give the same result for a given number of threads however
+ * they are scheduled. Build with OPENMP=1; otherwise there is one thread.
+ */
+#ifndef HYBRID_HXX
+#define HYBRID_HXX
+
+#include <string>
+
+typedef enum intra_tree {
+	INTRA_FIXED,
+	INTRA_OMP,
+	INTRA_TREE
+} intra_tree_t;
+
+typedef struct intra_result {
+	double sum;           // The node's partial dot product
+	double compute_time;  // Thread partials, and for INTRA_OMP the reduction too
+	double combine_time;  // Combining thread partials, NaN for INTRA_OMP
+	int threads;
+	long long height;     // Of the combining tree, -1 if unknown (INTRA_OMP)
+} intra_result_t;
+
+/* "fixed", "omp" or "tree". 0 on success, 1 on failure. */
+int parse_intra(std::string description, intra_tree_t *how);
+
+/* Threads intra_dot will use */
+int intra_threads();
+
+intra_result_t intra_dot(const double *a, const double *b, long long n, intra_tree_t how);
+
+#endif
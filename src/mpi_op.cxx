@@ -1,4 +1,7 @@
 /* MPI Operations */
+#include <cstddef>
+#include <cstring>
+
 #include "mpi_op.hxx"
 
 void noncommutative_sum(double *in, double *inout, int *len, MPI_Datatype *dptr)
@@ -13,3 +16,93 @@ void noncommutative_sum(double *in, double *inout, int *len, MPI_Datatype *dptr)
 	}
 }
 
+subn_count_t mpi_subnormal_counts = {0, 0, 0};
+
+void subnormal_counting_sum(double *in, double *inout, int *len, MPI_Datatype *dptr)
+{
+	long int i;
+	double s;
+	for (i = 0; i < *len; ++i) {
+		s = (*in) + (*inout);
+		subn_count_op(mpi_subnormal_counts, is_subnormal(*in) || is_subnormal(*inout),
+		              is_subnormal(s));
+		*inout = s;
+		in++;
+		inout++;
+	}
+}
+
+void running_error_sum(running_error<double> *in, running_error<double> *inout,
+                       int *len, MPI_Datatype *dptr)
+{
+	long int i;
+	for (i = 0; i < *len; ++i) {
+		*inout += *in;
+		in++;
+		inout++;
+	}
+}
+
+/* running_error<double> is laid out as double[2] (value, error bound) */
+static_assert(sizeof(running_error<double>) == 2 * sizeof(double),
+              "running_error<double> must be two packed doubles");
+int running_error_type(MPI_Datatype *type)
+{
+	int rc;
+	rc = MPI_Type_contiguous(2, MPI_DOUBLE, type);
+	if (rc != MPI_SUCCESS) {
+		return rc;
+	}
+	return MPI_Type_commit(type);
+}
+
+void scaled_prod_op(scaled_double *in, scaled_double *inout, int *len, MPI_Datatype *dptr)
+{
+	long int i;
+	for (i = 0; i < *len; ++i) {
+		*inout = *in * *inout;
+		in++;
+		inout++;
+	}
+}
+
+/* scaled_double is a double, then an int64_t */
+int scaled_type(MPI_Datatype *type)
+{
+	int rc, lens[2] = {1, 1};
+	MPI_Aint disps[2] = {offsetof(scaled_double, m), offsetof(scaled_double, e)};
+	MPI_Datatype types[2] = {MPI_DOUBLE, MPI_INT64_T}, packed;
+	rc = MPI_Type_create_struct(2, lens, disps, types, &packed);
+	if (rc != MPI_SUCCESS) {
+		return rc;
+	}
+	rc = MPI_Type_create_resized(packed, 0, sizeof(scaled_double), type);
+	MPI_Type_free(&packed);
+	if (rc != MPI_SUCCESS) {
+		return rc;
+	}
+	return MPI_Type_commit(type);
+}
+
+uint64_t bits_hash(const double *buf, int count)
+{
+	uint64_t h = 0x9e3779b97f4a7c15ULL, u;
+	for (int i = 0; i < count; i++) {
+		memcpy(&u, &buf[i], sizeof(u));
+		/* splitmix64 finalizer of each word folded into the hash */
+		h ^= u + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+		h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+		h ^= h >> 31;
+	}
+	return h;
+}
+
+bool allreduce_agrees(const double *buf, int count, MPI_Comm comm)
+{
+	unsigned long long h[2], m[2];
+	h[0] = bits_hash(buf, count);
+	h[1] = ~h[0];
+	MPI_Allreduce(h, m, 2, MPI_UNSIGNED_LONG_LONG, MPI_MIN, comm);
+	return m[0] == ~m[1];
+}
@@ -1,5 +1,30 @@
 #ifndef MPI_OP
 #define MPI_OP
 #include <mpi.h>
+#include <stdint.h>
+#include "running_error.hxx"
+#include "scaled_prod.hxx"
+#include "subnormal.hxx"
 void noncommutative_sum(double *in, double *inout, int *len, MPI_Datatype *dptr);
+/* Sum of doubles that also counts, in mpi_subnormal_counts of the rank
+ * running it, the additions that consume or produce subnormals. Create it
+ * commutative or not to count the tree the library picks for either. */
+extern subn_count_t mpi_subnormal_counts;
+void subnormal_counting_sum(double *in, double *inout, int *len, MPI_Datatype *dptr);
+/* Sum of running_error<double>, so a reduction also returns a bound on its
+ * own rounding error. Use with the datatype from running_error_type. */
+void running_error_sum(running_error<double> *in, running_error<double> *inout,
+                       int *len, MPI_Datatype *dptr);
+int running_error_type(MPI_Datatype *type);
+/* Product of scaled_double, which neither overflows nor underflows. Create
+ * it commutative or not; use with the datatype from scaled_type. */
+void scaled_prod_op(scaled_double *in, scaled_double *inout, int *len, MPI_Datatype *dptr);
+int scaled_type(MPI_Datatype *type);
+/* Hash of the bits of buf, so equal hashes mean equal bits but for a
+ * 2^-64 chance; -0.0 and 0.0, or two NaNs, differ */
+uint64_t bits_hash(const double *buf, int count);
+/* Whether buf, after an allreduce, holds the same bits on every rank of
+ * comm: one more allreduce, of two integers, the least hash and the least
+ * complement (the greatest hash). Collective; every rank gets the answer. */
+bool allreduce_agrees(const double *buf, int count, MPI_Comm comm);
 #endif
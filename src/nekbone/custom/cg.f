@@ -39,31 +39,33 @@ c     set machine tolerances
       call copy (r,f,n)
       call maskit (r,cmask,nx1,ny1,nz1) ! Zero out Dirichlet conditions
 
-      rnorm = sqrt(glsc3(r,c,r,n))
       iter = 0
+      call glsc3_iter(iter)
+      rnorm = sqrt(glsc3t(r,c,r,n,0))
       if (nid.eq.0)  write(6,6) iter,rnorm
 
       miter = niter
 c     call tester(z,r,n)  
       do iter=1,miter
+         call glsc3_iter(iter)
          call solveM(z,r,n)    ! preconditioner here
 
          rtz2=rtz1                                                       ! OPS
-         rtz1=glsc3(r,c,z,n)   ! parallel weighted inner product r^T C z ! 3n
+         rtz1=glsc3t(r,c,z,n,1) ! parallel weighted inner product r^T C z ! 3n
 
          beta = rtz1/rtz2
          if (iter.eq.1) beta=0.0
          call add2s1(p,z,beta,n)                                         ! 2n
 
          call ax(w,p,g,ur,us,ut,wk,n)                                    ! flopa
-         pap=glsc3(w,c,p,n)                                              ! 3n
+         pap=glsc3t(w,c,p,n,2)                                            ! 3n
 
          alpha=rtz1/pap
          alphm=-alpha
          call add2s2(x,p,alpha,n)                                        ! 2n
          call add2s2(r,w,alphm,n)                                        ! 2n
 
-         rtr = glsc3(r,c,r,n)                                            ! 3n
+         rtr = glsc3t(r,c,r,n,3)                                          ! 3n
          if (iter.eq.1) rlim2 = rtr*eps**2
          if (iter.eq.1) rtr0  = rtr
          rnorm = sqrt(rtr)
@@ -80,6 +82,25 @@ c        if (rtr.le.rlim2) goto 1001
 
       flop_cg = flop_cg + iter*15.*n
 
+      return
+      end
+c-----------------------------------------------------------------------
+      function glsc3t(a,b,mult,n,id)
+c
+c     glsc3 with the reduction done by glsc3_reduce in glsc3_trace.cxx,
+c     which can trace it per iteration. id is the call site in cg.
+c
+      common /nekmpi/ nid_,np_,nekcomm,nekgroup,nekreal
+      real a(n),b(n),mult(n)
+      real tmp
+
+      tmp = 0.0
+      do i=1,n
+         tmp = tmp + a(i)*b(i)*mult(i)
+      enddo
+      call glsc3_reduce(tmp,id,nekcomm)
+      glsc3t = tmp
+
       return
       end
 c-----------------------------------------------------------------------
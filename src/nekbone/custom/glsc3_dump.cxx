@@ -0,0 +1,44 @@
+/* Print a trace from glsc3_trace.cxx as TSV for the analysis scripts.
+ * Build with c++ -o glsc3_dump glsc3_dump.cxx */
+#include <cstdio>
+#include <cstring>
+
+#include "glsc3_trace.hxx"
+
+#define USAGE ("glsc3_dump <trace file>\n")
+
+int main(int argc, char *argv[])
+{
+	FILE *in;
+	glsc3_trace_header h;
+	glsc3_trace_record r;
+
+	if (argc != 2) {
+		fprintf(stderr, USAGE);
+		return 1;
+	}
+	in = fopen(argv[1], "rb");
+	if (in == NULL) {
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		return 1;
+	}
+	if (fread(&h, sizeof(h), 1, in) != 1
+			|| strncmp(h.magic, GLSC3_TRACE_MAGIC, sizeof(h.magic)) != 0
+			|| h.version != GLSC3_TRACE_VERSION
+			|| h.nvalues != GLSC3_NVALUES
+			|| h.record_size != (int32_t) sizeof(r)) {
+		fprintf(stderr, "%s is not a version %d glsc3 trace\n", argv[1], GLSC3_TRACE_VERSION);
+		fclose(in);
+		return 1;
+	}
+	printf("nranks\tsolve\titer\tcall\tallreduce\treference\trank order\tbinomial\tallreduce error\n");
+	while (fread(&r, sizeof(r), 1, in) == 1) {
+		printf("%d\t%d\t%d\t%d\t%.17e\t%.17e\t%.17e\t%.17e\t%.17e\n",
+			h.nranks, r.solve, r.iter, r.call,
+			r.value[GLSC3_ALLREDUCE], r.value[GLSC3_REFERENCE],
+			r.value[GLSC3_RANK_ORDER], r.value[GLSC3_BINOMIAL],
+			r.value[GLSC3_ALLREDUCE] - r.value[GLSC3_REFERENCE]);
+	}
+	fclose(in);
+	return 0;
+}
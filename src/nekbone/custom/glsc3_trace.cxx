@@ -0,0 +1,182 @@
+/* Fortran-callable replacement for the reduction at the end of glsc3.
+ * Without GLSC3_TRACE in the environment glsc3_reduce is one MPI_Allreduce,
+ * as gop does. With GLSC3_TRACE=<file>, every traced call also gathers the
+ * partial sums of all ranks, and rank 0 records what the allreduce returned
+ * next to other reduction orders of the same partial sums (glsc3_trace.hxx).
+ * One run then shows, iteration by iteration, how the allreduce algorithm
+ * moves rtz1, pap and rtr away from a reproducible result.
+ *
+ * Environment:
+ * GLSC3_TRACE=<file>      Trace file written by rank 0
+ * GLSC3_TRACE_EVERY=<k>   Only trace every k-th CG iteration (default 1)
+ * GLSC3_RESULT=reference  Return the reproducible sum to cg instead of the
+ *                         allreduce, so the solve itself is reproducible.
+ *                         Works with or without GLSC3_TRACE.
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+/* Linked by the Fortran compiler, so keep out the MPI C++ bindings */
+#define OMPI_SKIP_MPICXX 1
+#define MPICH_SKIP_MPICXX 1
+#include <mpi.h>
+
+#include "glsc3_trace.hxx"
+
+#define TRACE_BUFFER 4096 // Records kept before writing
+
+static struct {
+	bool init;
+	bool on;
+	bool use_reference;
+	long every;
+	int rank, nranks;
+	int32_t solve, iter;
+	FILE *out;
+	std::vector<double> partial;
+	std::vector<double> work;
+	std::vector<glsc3_trace_record> buf;
+} tr;
+
+static void trace_flush()
+{
+	if (tr.out != NULL && !tr.buf.empty()) {
+		fwrite(tr.buf.data(), sizeof(glsc3_trace_record), tr.buf.size(), tr.out);
+		tr.buf.clear();
+	}
+}
+
+static void trace_close()
+{
+	trace_flush();
+	if (tr.out != NULL) {
+		fclose(tr.out);
+		tr.out = NULL;
+	}
+}
+
+static void trace_init(MPI_Comm comm)
+{
+	const char *fn = getenv("GLSC3_TRACE");
+	const char *every = getenv("GLSC3_TRACE_EVERY");
+	const char *result = getenv("GLSC3_RESULT");
+	glsc3_trace_header h;
+
+	tr.init = true;
+	tr.use_reference = result != NULL && std::string(result) == "reference";
+	tr.on = (fn != NULL && fn[0] != '\0') || tr.use_reference;
+	if (!tr.on) {
+		return;
+	}
+	tr.every = every != NULL && atol(every) > 0 ? atol(every) : 1;
+	MPI_Comm_rank(comm, &tr.rank);
+	MPI_Comm_size(comm, &tr.nranks);
+	tr.partial.resize(tr.nranks);
+	tr.work.resize(tr.nranks);
+	if (tr.rank != 0 || fn == NULL || fn[0] == '\0') {
+		return;
+	}
+	tr.out = fopen(fn, "wb");
+	if (tr.out == NULL) {
+		fprintf(stderr, "glsc3_trace: could not open %s, not tracing\n", fn);
+		return;
+	}
+	memset(&h, 0, sizeof(h));
+	strncpy(h.magic, GLSC3_TRACE_MAGIC, sizeof(h.magic));
+	h.version = GLSC3_TRACE_VERSION;
+	h.nranks = tr.nranks;
+	h.nvalues = GLSC3_NVALUES;
+	h.record_size = sizeof(glsc3_trace_record);
+	fwrite(&h, sizeof(h), 1, tr.out);
+	tr.buf.reserve(TRACE_BUFFER);
+	atexit(trace_close);
+}
+
+/* Neumaier's compensated summation, in rank order */
+static double reference_sum(const double *x, int n)
+{
+	double s = 0.0, c = 0.0, t;
+	for (int i = 0; i < n; i++) {
+		t = s + x[i];
+		if (std::abs(s) >= std::abs(x[i])) {
+			c += (s - t) + x[i];
+		} else {
+			c += (x[i] - t) + s;
+		}
+		s = t;
+	}
+	return s + c;
+}
+
+static double rank_order_sum(const double *x, int n)
+{
+	double s = 0.0;
+	for (int i = 0; i < n; i++) {
+		s += x[i];
+	}
+	return s;
+}
+
+/* Rank i receives from i + mask for mask = 1, 2, 4, ... */
+static double binomial_sum(const double *x, double *w, int n)
+{
+	memcpy(w, x, n * sizeof(double));
+	for (int mask = 1; mask < n; mask <<= 1) {
+		for (int i = 0; i + mask < n; i += 2 * mask) {
+			w[i] = w[i] + w[i + mask];
+		}
+	}
+	return w[0];
+}
+
+extern "C" {
+
+/* Called from cg with the iteration about to start; 0 starts a new solve */
+void glsc3_iter_(int *iter)
+{
+	if (*iter == 0) {
+		tr.solve++;
+	}
+	tr.iter = *iter;
+}
+
+/* Sum x over comm in place. id tells the glsc3 calls of cg.f apart. */
+void glsc3_reduce_(double *x, int *id, MPI_Fint *comm)
+{
+	MPI_Comm c = MPI_Comm_f2c(*comm);
+	double local = *x;
+	double ref;
+	glsc3_trace_record r;
+
+	if (!tr.init) {
+		trace_init(c);
+	}
+	MPI_Allreduce(&local, x, 1, MPI_DOUBLE, MPI_SUM, c);
+	if (!tr.on || (tr.iter % tr.every != 0 && !tr.use_reference)) {
+		return;
+	}
+	MPI_Allgather(&local, 1, MPI_DOUBLE, tr.partial.data(), 1, MPI_DOUBLE, c);
+	ref = reference_sum(tr.partial.data(), tr.nranks);
+	if (tr.out != NULL && tr.iter % tr.every == 0) {
+		r.solve = tr.solve;
+		r.iter = tr.iter;
+		r.call = *id;
+		r.pad = 0;
+		r.value[GLSC3_ALLREDUCE] = *x;
+		r.value[GLSC3_REFERENCE] = ref;
+		r.value[GLSC3_RANK_ORDER] = rank_order_sum(tr.partial.data(), tr.nranks);
+		r.value[GLSC3_BINOMIAL] = binomial_sum(tr.partial.data(), tr.work.data(), tr.nranks);
+		tr.buf.push_back(r);
+		if (tr.buf.size() >= TRACE_BUFFER) {
+			trace_flush();
+		}
+	}
+	if (tr.use_reference) {
+		*x = ref;
+	}
+}
+
+}
@@ -0,0 +1,37 @@
+/* Binary trace written by glsc3_trace.cxx and read by glsc3_dump.cxx.
+ * The file is a glsc3_trace_header followed by glsc3_trace_record until EOF,
+ * all in the byte order of the machine that wrote it. */
+#ifndef GLSC3_TRACE_HXX
+#define GLSC3_TRACE_HXX
+
+#include <stdint.h>
+
+#define GLSC3_TRACE_MAGIC "GLSC3TR"
+#define GLSC3_TRACE_VERSION 1
+
+/* Values recorded for each reduction, all of the same per-rank partial sums */
+enum glsc3_value_t {
+	GLSC3_ALLREDUCE,   // MPI_Allreduce as configured, e.g. --cfg=smpi/allreduce
+	GLSC3_REFERENCE,   // Compensated sum in rank order, the same on every rank
+	GLSC3_RANK_ORDER,  // Left associative in rank order, as a linear reduce
+	GLSC3_BINOMIAL,    // Binomial tree rooted at rank 0
+	GLSC3_NVALUES
+};
+
+struct glsc3_trace_header {
+	char magic[8];
+	int32_t version;
+	int32_t nranks;
+	int32_t nvalues;
+	int32_t record_size;
+};
+
+struct glsc3_trace_record {
+	int32_t solve;     // Number of the call to cg, from 1
+	int32_t iter;      // CG iteration, 0 for the initial residual
+	int32_t call;      // Which glsc3 in cg.f
+	int32_t pad;
+	double value[GLSC3_NVALUES];
+};
+
+#endif
@@ -7,7 +7,8 @@ if [ ! -d "test" ]; then
 	mv -f Nekbone/src && mv -f Nekbone/test && rm -rf Nekbone
 fi
 cp custom/cg.f src/
-cp custom/makenek custom/nekpmpi test/example1/
+cp custom/makenek custom/nekpmpi custom/makefile_usr.inc custom/glsc3_trace.cxx \
+   custom/glsc3_trace.hxx test/example1/
 mkdir -p experiments
 cd "test/example1/"
 
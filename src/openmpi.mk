@@ -9,8 +9,14 @@ ifndef ($(MPICXX))
 $(error "make clean, then rerun with USE_MPI=1 MPICXX=mpicxx make")
 endif
 
+ASSOC_SEED = 42
+
 # For running on the host MPI (i.e. not Simgrid)
 NUM_PROCS_LOCAL = 16
+# Hybrid runs: ranks times threads per rank should be the number of cores
+HYBRID_PROCS = 4
+HYBRID_THREADS = 4
+HYBRID_LEN = 16000000
 
 # MPI and MPI Modular Component Architecture commands (OpenMPI). Currently Unused
 VERBOSITY = coll_base_verbose 0
@@ -27,6 +33,14 @@ OMPI_ALGOS = 0 1 2 3 4 5 6 7
 # 6:"in-order_binary"
 # 7:"rabenseifner"
 
+# Each intra-node tree with HYBRID_THREADS threads per rank
+hybrid :
+	$(foreach tree,fixed omp tree,\
+		echo "$(HYBRID_LEN) runif[-1,1] $(ASSOC_SEED) 10 hybrid_$(tree)" > hybrid-$(tree).jobs ; \
+		OMP_NUM_THREADS=$(HYBRID_THREADS) mpirun -np $(HYBRID_PROCS) -x OMP_NUM_THREADS --bind-to none \
+			./dotprod_mpi -f hybrid-$(tree).jobs native $(tree) ; \
+		$(RM) hybrid-$(tree).jobs ;)
+
 # OpenMPI command line arguments
 ompi :
 	$(foreach algo,$(OMPI_ALGOS),\
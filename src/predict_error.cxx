@@ -0,0 +1,83 @@
+/* Predict the distribution of summation error over random associations,
+ * for the same vectors assoc_test would generate. */
+#ifndef PREDICT_ERROR_CXX
+#define PREDICT_ERROR_CXX
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include "error_predict.hxx"
+#include "rand.hxx"
+
+#define USAGE ("predict_error <n> <distr> where\n"\
+               "<n> is the number of leaves in the reduction tree\n"\
+               "<distr> is the distribution to use. Choices are:\n"\
+               "\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n")
+
+#define FLOAT_T double
+
+/* Probability used for the tail columns */
+#define TAIL_P 0.01
+
+static void print_prediction(long long len, const char *order, std::string dist,
+                             const char *model, err_moments_t e)
+{
+	printf("%lld\t%s\t%s\t%s\t%.6e\t%.6e\t%.6e\t%.6e\n", len, order,
+		dist.c_str(), model, e.mean, sqrt(e.var),
+		chebyshev_tail(e, TAIL_P), normal_tail(e, TAIL_P));
+}
+
+int main (int argc, char* argv[])
+{
+	int rc = 0;
+	long long len, i;
+	FLOAT_T (*rand_flt)(); // Function to generate a random float
+	FLOAT_T mag = 0.0, mean, var;
+	const double dvar = rounding_var<FLOAT_T>();
+	const assoc_order_t orders[] =
+		{LEFT_ASSOC, RANDOM_ASSOC, SHUFFLE_LEFT_ASSOC, SHUFFLE_RANDOM_ASSOC};
+	const char *names[] =
+		{"Left assoc", "Random assoc", "Shuffle l assoc", "Shuffle rand assoc"};
+
+	if (argc != 3) {
+		fprintf(stderr, USAGE);
+		return 1;
+	}
+	len = atoll(argv[1]);
+	if (len <= 0) {
+		fprintf(stderr, USAGE);
+		return 1;
+	}
+	std::string dist = argv[2];
+	rc = parse_distr<FLOAT_T>(dist, &mag, &rand_flt);
+	if (rc != 0) {
+		fprintf(stderr, "Unrecognized distribution:\n%s", USAGE);
+		return 1;
+	}
+
+	/* Same vector as assoc_test */
+	std::vector<FLOAT_T> a;
+	a.reserve(len);
+	set_seed(ASSOC_SEED, 0);
+	srand(ASSOC_SEED);
+	for (i = 0; i < len; i++) {
+		a.push_back(rand_flt());
+	}
+
+	printf("veclen\torder\tdistribution\tmodel\texpected error\tstd dev\t"
+	       "Chebyshev %g\tnormal %g\n", 1 - TAIL_P, 1 - TAIL_P);
+	for (i = 0; i < 4; i++) {
+		print_prediction(len, names[i], dist, "data",
+			predict_sum_error(len, &a[0], orders[i], dvar));
+		if (distr_moments(dist, &mean, &var) == 0) {
+			print_prediction(len, names[i], dist, "iid",
+				predict_sum_error_iid(len, mean, var, orders[i], dvar));
+		}
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,237 @@
+/* Phase profiler. See prof.hxx */
+#ifdef PROFILE
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "prof.hxx"
+
+/* Phases per process; later ones are not counted */
+#define PROF_MAX_PHASES 64
+
+struct prof_total {
+	long long calls;
+	uint64_t ticks, cycles, misses;
+};
+
+/* Totals of one thread. Fixed size, so a report can read them while the
+ * thread goes on. */
+struct prof_thread {
+	int id;       // 0 for the thread of prof_init, then in order of first use
+	int perf_fd;  // Leader of cycles and cache misses, -1 if none
+	prof_total total[PROF_MAX_PHASES];
+};
+
+/* Globals are per rank under SMPI, thread_local is not: the thread that
+ * called prof_init uses prof_main, so ranks sharing an OS thread keep
+ * their own totals. Other (OpenMP) threads get one of their own. */
+static std::mutex prof_lock;
+static std::string prof_name;
+static std::vector<std::string> prof_names;
+static std::vector<prof_thread *> prof_threads;
+static prof_thread prof_main;
+static std::thread::id prof_main_id;
+static thread_local prof_thread *prof_mine = NULL;
+static bool prof_perf = false;
+static uint64_t prof_ticks0;
+static double prof_secs0;
+static volatile sig_atomic_t prof_dump = 0;
+
+static inline uint64_t prof_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t t;
+	__asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (t));
+	return t;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static double prof_secs()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Cycles and cache misses of the calling thread in user space, read
+ * together through the leader. -1 if the kernel won't. */
+static int perf_open()
+{
+	struct perf_event_attr a;
+	int leader;
+	memset(&a, 0, sizeof(a));
+	a.size = sizeof(a);
+	a.type = PERF_TYPE_HARDWARE;
+	a.config = PERF_COUNT_HW_CPU_CYCLES;
+	a.read_format = PERF_FORMAT_GROUP;
+	a.exclude_kernel = 1;
+	a.exclude_hv = 1;
+	leader = (int) syscall(__NR_perf_event_open, &a, 0, -1, -1, 0);
+	if (leader < 0) {
+		return -1;
+	}
+	a.config = PERF_COUNT_HW_CACHE_MISSES;
+	if (syscall(__NR_perf_event_open, &a, 0, -1, leader, 0) < 0) {
+		close(leader);
+		return -1;
+	}
+	return leader;
+}
+
+static void perf_read(int fd, uint64_t *cycles, uint64_t *misses)
+{
+	uint64_t v[3];  // Number of events, then each
+	if (fd < 0 || read(fd, v, sizeof(v)) != (ssize_t) sizeof(v)) {
+		*cycles = *misses = 0;
+		return;
+	}
+	*cycles = v[1];
+	*misses = v[2];
+}
+
+static prof_thread *prof_self()
+{
+	if (std::this_thread::get_id() == prof_main_id) {
+		return &prof_main;
+	}
+	if (prof_mine == NULL) {
+		prof_mine = new prof_thread();
+		prof_mine->perf_fd = prof_perf ? perf_open() : -1;
+		std::lock_guard<std::mutex> g(prof_lock);
+		prof_mine->id = (int) prof_threads.size();
+		prof_threads.push_back(prof_mine);
+	}
+	return prof_mine;
+}
+
+static void prof_signal(int sig)
+{
+	prof_dump = 1;
+}
+
+void prof_init(const std::string &name)
+{
+	const char *perf = getenv("PROF_PERF");
+	prof_name = name;
+	prof_main_id = std::this_thread::get_id();
+	memset(prof_main.total, 0, sizeof(prof_main.total));
+	prof_main.id = 0;
+	prof_main.perf_fd = -1;
+	prof_perf = perf != NULL && std::string(perf) == "1";
+	if (prof_perf) {
+		prof_main.perf_fd = perf_open();
+		if (prof_main.perf_fd < 0) {
+			fprintf(stderr, "%s: perf_event_open failed, no counters "
+				"(see /proc/sys/kernel/perf_event_paranoid)\n", name.c_str());
+			prof_perf = false;
+		}
+	}
+	prof_threads.assign(1, &prof_main);
+	signal(SIGUSR1, prof_signal);
+	prof_ticks0 = prof_ticks();
+	prof_secs0 = prof_secs();
+}
+
+int prof_phase(const char *name)
+{
+	std::lock_guard<std::mutex> g(prof_lock);
+	for (size_t i = 0; i < prof_names.size(); i++) {
+		if (prof_names[i] == name) {
+			return (int) i;
+		}
+	}
+	prof_names.push_back(name);
+	return (int) prof_names.size() - 1;
+}
+
+prof_scope::prof_scope(int phase) : phase_(phase), cycles_(0), misses_(0)
+{
+	if (prof_perf) {
+		perf_read(prof_self()->perf_fd, &cycles_, &misses_);
+	}
+	ticks_ = prof_ticks();
+}
+
+prof_scope::~prof_scope()
+{
+	uint64_t t = prof_ticks(), c, m;
+	prof_thread *self = prof_self();
+	if (phase_ < PROF_MAX_PHASES) {
+		prof_total &p = self->total[phase_];
+		p.calls++;
+		p.ticks += t - ticks_;
+		if (prof_perf) {
+			perf_read(self->perf_fd, &c, &m);
+			p.cycles += c - cycles_;
+			p.misses += m - misses_;
+		}
+	}
+	if (prof_dump) {
+		prof_dump = 0;
+		prof_report();
+	}
+}
+
+void prof_report()
+{
+	const char *out = getenv("PROF_OUT");
+	double secs = prof_secs() - prof_secs0;
+	/* Ticks per second over the whole run so far */
+	double rate = secs > 0 ? (prof_ticks() - prof_ticks0) / secs : 1.0;
+	std::string rows;
+	char row[512];
+	int fd = 2;
+
+	std::lock_guard<std::mutex> g(prof_lock);
+	if (out != NULL && out[0] != '\0') {
+		fd = open(out, O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (fd < 0) {
+			fprintf(stderr, "Could not open %s\n", out);
+			return;
+		}
+	}
+	for (const prof_thread *t : prof_threads) {
+		for (size_t i = 0; i < prof_names.size() && i < PROF_MAX_PHASES; i++) {
+			const prof_total &p = t->total[i];
+			if (p.calls == 0) {
+				continue;
+			}
+			snprintf(row, sizeof(row), "%s\t%d\t%s\t%lld\t%.9f\t%s\t%s\n",
+				prof_name.c_str(), t->id, prof_names[i].c_str(), p.calls, p.ticks / rate,
+				prof_perf ? std::to_string(p.cycles).c_str() : "NA",
+				prof_perf ? std::to_string(p.misses).c_str() : "NA");
+			rows += row;
+		}
+	}
+	/* A header for stderr, and for a new file */
+	if (!rows.empty() && (fd == 2 || lseek(fd, 0, SEEK_END) == 0)) {
+		rows = "name\tthread\tphase\tcalls\tseconds\tcycles\tcache misses\n" + rows;
+	}
+	/* One write, so the rows of ranks appending together stay whole */
+	if (write(fd, rows.data(), rows.size()) != (ssize_t) rows.size()) {
+		fprintf(stderr, "Could not write the profile\n");
+	}
+	if (fd != 2) {
+		close(fd);
+	}
+}
+
+#endif
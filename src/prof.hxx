@@ -0,0 +1,61 @@
+/* Phase profiler: where the time of a run goes, at the granularity of the
+ * phases we choose to mark, cheap enough to leave in long runs.
+ *
+ *   PROF_INIT("rank 3");        once, naming this process in the report
+ *   { PROF_SCOPE("mpfr"); ... } adds the time until the end of the block
+ *   PROF_REPORT();              prints the totals, e.g. at the end of main
+ *
+ * Build with PROFILE=1 (-DPROFILE) to turn it on; otherwise the macros are
+ * empty and prof.cxx compiles to nothing.
+ *
+ * Time is read from the time-stamp counter (rdtsc, or cntvct_el0 on
+ * AArch64), a few ns per read, and converted to seconds by comparing it to
+ * the steady clock over the run. With PROF_PERF=1 each scope also reads
+ * cycles and cache misses of its thread from perf_event_open, about a
+ * microsecond per scope, so mark phases, not loop bodies. Nested scopes
+ * count in their parents too.
+ *
+ * Totals are kept per thread and reported per thread, one TSV row per
+ * phase, on stderr or appended to $PROF_OUT: the name from PROF_INIT (the
+ * rank, for MPI), thread, phase, calls, seconds, cycles, cache misses.
+ * SIGUSR1 makes the next scope to end print the totals so far, to look at
+ * a long run without stopping it.
+ */
+#ifndef PROF_HXX
+#define PROF_HXX
+
+#ifdef PROFILE
+
+#include <stdint.h>
+#include <string>
+
+void prof_init(const std::string &name);
+int prof_phase(const char *name);  // Id of the phase called name
+void prof_report();
+
+class prof_scope {
+	public:
+		prof_scope(int phase);
+		~prof_scope();
+	private:
+		int phase_;
+		uint64_t ticks_, cycles_, misses_;
+};
+
+#define PROF_CAT2(a, b) a##b
+#define PROF_CAT(a, b) PROF_CAT2(a, b)
+#define PROF_INIT(name) prof_init(name)
+#define PROF_SCOPE(name) \
+	static const int PROF_CAT(prof_phase_, __LINE__) = prof_phase(name); \
+	prof_scope PROF_CAT(prof_scope_, __LINE__)(PROF_CAT(prof_phase_, __LINE__))
+#define PROF_REPORT() prof_report()
+
+#else
+
+#define PROF_INIT(name) ((void) 0)
+#define PROF_SCOPE(name) ((void) 0)
+#define PROF_REPORT() ((void) 0)
+
+#endif
+
+#endif
@@ -23,6 +23,8 @@
 #include <string>
 #include <algorithm>
 
+#include "rand.hxx"
+
 /* A version of Marsaglia-MultiCarry */
 
 static unsigned int I1=1234, I2=5678;
@@ -38,11 +40,11 @@ void get_seed(unsigned int *i1, unsigned int *i2)
 }
 
 
-double unif_rand_R(void)
+double unif_rand_R_r(rand_state_t *s)
 {
-    I1= 36969*(I1 & 0177777) + (I1>>16);
-    I2= 18000*(I2 & 0177777) + (I2>>16);
-    return ((I1 << 16)^(I2 & 0177777)) * 2.328306437080797e-10; /* in [0,1) */
+    s->i1= 36969*(s->i1 & 0177777) + (s->i1>>16);
+    s->i2= 18000*(s->i2 & 0177777) + (s->i2>>16);
+    return ((s->i1 << 16)^(s->i2 & 0177777)) * 2.328306437080797e-10; /* in [0,1) */
 }
 
 typedef union Double Double;
@@ -51,14 +53,14 @@ union Double {
     unsigned long long d;
 };
 
-double subnormal_rand(void)
+double subnormal_rand_r(rand_state_t *s)
 {
-	I1= 36969*(I1 & 0177777) + (I1>>16);
-	I2= 18000*(I2 & 0177777) + (I2>>16);
+	s->i1= 36969*(s->i1 & 0177777) + (s->i1>>16);
+	s->i2= 18000*(s->i2 & 0177777) + (s->i2>>16);
 
 	Double x;
-	long long unsigned i1 = (unsigned long long) I1;
-	long long unsigned i2 = (unsigned long long) I2;
+	long long unsigned i1 = (unsigned long long) s->i1;
+	long long unsigned i2 = (unsigned long long) s->i2;
 
 	x.d = (i1 << 32) ^ i2;
 	/* Clear sign and most significant exponent digit so that sign is positive
@@ -68,14 +70,44 @@ double subnormal_rand(void)
 	return x.f;
 }
 
+double unif_rand_R1_r(rand_state_t *s)
+{
+	return 2 * (unif_rand_R_r(s) - 0.5);
+}
+
+double unif_rand_R1000_r(rand_state_t *s)
+{
+	return 2000 * (unif_rand_R_r(s) - 0.5);
+}
+
+/* The global seeds, as a rand_state_t for the call */
+static double with_global_seed(double (*f)(rand_state_t *))
+{
+	rand_state_t s = {I1, I2};
+	double x = f(&s);
+	I1 = s.i1;
+	I2 = s.i2;
+	return x;
+}
+
+double unif_rand_R(void)
+{
+	return with_global_seed(unif_rand_R_r);
+}
+
+double subnormal_rand(void)
+{
+	return with_global_seed(subnormal_rand_r);
+}
+
 double unif_rand_R1()
 {
-	return 2 * (unif_rand_R() - 0.5);
+	return with_global_seed(unif_rand_R1_r);
 }
 
 double unif_rand_R1000()
 {
-	return 2000 * (unif_rand_R() - 0.5);
+	return with_global_seed(unif_rand_R1000_r);
 }
 
 template <typename FLOAT_T>
@@ -99,6 +131,57 @@ int parse_distr(std::string description, double* mag, FLOAT_T (**distr)())
 	return 0;
 }
 
+int parse_distr_r(std::string description, double (**distr)(rand_state_t *))
+{
+	if (description == "runif[0,1]") {
+		*distr = &unif_rand_R_r;
+	} else if (description == "runif[-1,1]") {
+		*distr = &unif_rand_R1_r;
+	} else if (description == "runif[-1000,1000]") {
+		*distr = &unif_rand_R1000_r;
+	} else if (description == "rsubn") {
+		*distr = &subnormal_rand_r;
+	} else {
+		return 1;
+	}
+	return 0;
+}
+
+rand_state_t rand_stream(unsigned int seed, unsigned long long k)
+{
+	rand_state_t s;
+	unsigned long long z = ((unsigned long long) seed << 32) ^ k;
+	z += 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	z ^= z >> 31;
+	s.i1 = (unsigned int) z;
+	s.i2 = (unsigned int) (z >> 32);
+	/* A zero half of the generator would stay zero */
+	s.i1 = s.i1 == 0 ? 1 : s.i1;
+	s.i2 = s.i2 == 0 ? 1 : s.i2;
+	return s;
+}
+
+int distr_moments(std::string description, double* mean, double* var)
+{
+	/* U(a,b) has mean (a+b)/2 and variance (b-a)^2/12 */
+	if (description == "runif[0,1]") {
+		*mean = 0.5;
+		*var = 1. / 12.;
+	} else if (description == "runif[-1,1]") {
+		*mean = 0.;
+		*var = 4. / 12.;
+	} else if (description == "runif[-1000,1000]") {
+		*mean = 0.;
+		*var = 2000. * 2000. / 12.;
+	} else {
+		/* Includes rsubn, which has no closed form */
+		return 1;
+	}
+	return 0;
+}
+
 /* Explicit template instantiation. */
 // float currently not supported.
 // template int parse_distr(std::string description, float (**distr)());
@@ -21,4 +21,24 @@ double subnormal_rand(void);
 template <typename FLOAT_T>
 int parse_distr(std::string description, double* mag, FLOAT_T (**distr)());
 
+/* The same generators with the seeds passed in rather than global, so each
+ * thread can have its own stream. The functions above are these on the
+ * seeds of set_seed. */
+typedef struct rand_state {
+	unsigned int i1, i2;
+} rand_state_t;
+
+double unif_rand_R_r(rand_state_t *s);
+double unif_rand_R1_r(rand_state_t *s);
+double unif_rand_R1000_r(rand_state_t *s);
+double subnormal_rand_r(rand_state_t *s);
+int parse_distr_r(std::string description, double (**distr)(rand_state_t *));
+/* Seeds of stream k of seed, from splitmix64, so streams can be generated
+ * independently and in any order. Neither half is zero. */
+rand_state_t rand_stream(unsigned int seed, unsigned long long k);
+
+/* Mean and variance of a distribution named as in parse_distr. 0 on success,
+ * 1 if unknown or there is no closed form. */
+int distr_moments(std::string description, double* mean, double* var);
+
 #endif
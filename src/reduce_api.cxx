@@ -0,0 +1,266 @@
+/* C API over assoc_test's core. See reduce_api.h */
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <boost/multiprecision/mpfr.hpp>
+
+#include "rand.hxx"
+#include "reduce_api.h"
+#include "scaled_prod.hxx"
+#include "shuffle_assoc.hxx"
+#include "tree_shape.hxx"
+
+using namespace boost::multiprecision;
+
+static std::string rapi_msg;
+
+static int fail(const std::string &msg)
+{
+	rapi_msg = msg;
+	return 1;
+}
+
+/* 0 if a reduction of n elements with op can be done */
+static int check(long long n, int op)
+{
+	if (op != RAPI_SUM && op != RAPI_PROD) {
+		return fail("op must be RAPI_SUM or RAPI_PROD");
+	}
+	if (n < 1) {
+		return fail("n must be positive");
+	}
+	return 0;
+}
+
+/* As grow_random_binary_tree's L array */
+static int check_shape(long long n)
+{
+	if (2 * (n - 1) + 1 >= RAND_MAX) {
+		return fail("Trees over " + std::to_string(n) + " leaves are too big to draw");
+	}
+	return 0;
+}
+
+/* Products as a mantissa in [0.5, 1) and an exponent, however they were
+ * computed; sums as they are, with exponent 0 */
+static void put(const scaled_double &x, int op, double *val, double *exp2)
+{
+	scaled_double r = x;
+	if (op == RAPI_PROD) {
+		r.renormalize();
+	}
+	if (exp2 == NULL) {
+		*val = std::ldexp(r.m, (int) std::max<int64_t>(std::min<int64_t>(r.e, 4096), -4096));
+	} else {
+		*val = r.m;
+		*exp2 = (double) r.e;
+	}
+}
+
+static scaled_double get(const double *val, const double *exp2, long long i)
+{
+	return scaled_double(val[i], exp2 == NULL ? 0 : (int64_t) exp2[i]);
+}
+
+/* Exact result to measure errors against: the sum in exact_sum, or the
+ * product in exact_prod */
+static void exact_of(const double *a, long long n, int op, mpfr_float_1000 &exact_sum,
+                     scaled_double &exact_prod)
+{
+	if (op == RAPI_SUM) {
+		exact_sum = 0;
+		for (long long i = 0; i < n; i++) {
+			exact_sum += a[i];
+		}
+	} else {
+		exact_prod = scaled_exact_prod(a, n);
+	}
+}
+
+static double error_of(int op, double val, const scaled_double &x, const mpfr_float_1000 &exact_sum,
+                       const scaled_double &exact_prod)
+{
+	if (op == RAPI_SUM) {
+		return mpfr_float_1000(exact_sum - val).convert_to<double>();
+	}
+	return scaled_rel_error(x, exact_prod);
+}
+
+const char *rapi_error(void)
+{
+	return rapi_msg.c_str();
+}
+
+int rapi_generate(const char *distr, unsigned int seed, long long n, double *out)
+{
+	double mag;
+	double (*rand_flt)();
+	if (n < 0) {
+		return fail("n must not be negative");
+	}
+	if (parse_distr<double>(distr, &mag, &rand_flt) != 0) {
+		return fail(std::string("Unrecognized distribution ") + distr);
+	}
+	set_seed(seed, 0);
+	for (long long i = 0; i < n; i++) {
+		out[i] = rand_flt();
+	}
+	return 0;
+}
+
+long long rapi_shape_words(long long n)
+{
+	return 1 + shape_words(n);
+}
+
+int rapi_shapes(long long n, unsigned int seed, long long count, uint64_t *bits)
+{
+	std::vector<uint64_t> s;
+	long long w = rapi_shape_words(n);
+	if (check(n, RAPI_SUM) != 0 || check_shape(n) != 0) {
+		return 1;
+	}
+	srand(seed);
+	for (long long c = 0; c < count; c++) {
+		shape_draw(n, s);
+		bits[c * w] = (uint64_t) n;
+		memcpy(bits + c * w + 1, s.data(), (w - 1) * sizeof(uint64_t));
+	}
+	return 0;
+}
+
+int rapi_eval(const double *a, long long n, int op, const uint64_t *shape,
+              double *val, double *exp2, long long *height)
+{
+	tree_shape_t s;
+	long long i, j = 0, h = n - 1;
+	double acc = 0.0;
+	scaled_double prod;
+	if (check(n, op) != 0) {
+		return 1;
+	}
+	if (shape != NULL && shape[0] != (uint64_t) n) {
+		return fail("The shape is over " + std::to_string(shape[0]) + " leaves, not "
+		            + std::to_string(n));
+	}
+	if (shape != NULL && !shape_valid(shape + 1, n)) {
+		return fail("The shape is not a tree over " + std::to_string(n) + " leaves");
+	}
+	s.leaves = n;
+	s.bits = shape == NULL ? NULL : shape + 1;
+	if (op == RAPI_SUM && shape == NULL) {
+		for (i = 0; i < n; i++) {
+			acc = acc + a[i];
+		}
+		prod = scaled_double(acc, 0);
+	} else if (op == RAPI_SUM) {
+		prod = scaled_double(shape_eval<double>(s, [&]() { return a[j++]; }, true, &h), 0);
+	} else if (shape == NULL) {
+		prod = scaled_left_prod(a, n);
+	} else {
+		prod = shape_eval<scaled_double>(s, [&]() { return scaled_double(a[j++]); }, false, &h);
+	}
+	put(prod, op, val, exp2);
+	if (height != NULL) {
+		*height = h;
+	}
+	return 0;
+}
+
+int rapi_exact(const double *a, long long n, int op, double *val, double *exp2)
+{
+	mpfr_float_1000 exact_sum;
+	scaled_double exact_prod;
+	if (check(n, op) != 0) {
+		return 1;
+	}
+	exact_of(a, n, op, exact_sum, exact_prod);
+	if (op == RAPI_SUM) {
+		exact_prod = scaled_double(exact_sum.convert_to<double>(), 0);
+	}
+	put(exact_prod, op, val, exp2);
+	return 0;
+}
+
+int rapi_errors(const double *a, long long n, int op, const double *val,
+                const double *exp2, long long m, double *err)
+{
+	mpfr_float_1000 exact_sum;
+	scaled_double exact_prod;
+	if (check(n, op) != 0) {
+		return 1;
+	}
+	exact_of(a, n, op, exact_sum, exact_prod);
+	for (long long i = 0; i < m; i++) {
+		err[i] = error_of(op, val[i], get(val, exp2, i), exact_sum, exact_prod);
+	}
+	return 0;
+}
+
+int rapi_trials(const double *a, long long n, int op, unsigned int seed, long long iters,
+                double *fora, double *rola, double *rora, int *fora_height, int *rora_height)
+{
+	mpfr_float_1000 exact_sum;
+	scaled_double exact_prod, r;
+	std::vector<uint64_t> bits;
+	std::vector<double> scratch;
+	std::vector<scaled_double> as, scaled_scratch;
+	shuffle_sums<double> sums;
+	shuffle_sums<scaled_double> prods;
+	tree_shape_t s;
+	long long i, j, h;
+	double v;
+
+	if (check(n, op) != 0 || check_shape(n) != 0) {
+		return 1;
+	}
+	exact_of(a, n, op, exact_sum, exact_prod);
+	if (op == RAPI_PROD) {
+		as.assign(a, a + n);
+	}
+	s.leaves = n;
+	srand(seed);
+	for (i = 0; i < iters; i++) {
+		/* Random association, in order */
+		shape_draw(n, bits);
+		s.bits = bits.data();
+		j = 0;
+		if (op == RAPI_SUM) {
+			v = shape_eval<double>(s, [&]() { return a[j++]; }, true, &h);
+			r = scaled_double(v, 0);
+		} else {
+			r = shape_eval<scaled_double>(s, [&]() { return as[j++]; }, false, &h);
+		}
+		if (fora != NULL) {
+			fora[i] = error_of(op, r.m, r, exact_sum, exact_prod);
+		}
+		if (fora_height != NULL) {
+			fora_height[i] = (int) h;
+		}
+
+		/* A shuffle, left-associative and in another random association */
+		shape_draw(n, bits);
+		s.bits = bits.data();
+		if (op == RAPI_SUM) {
+			sums = shuffle_associate<double>(a, n, true, s, rand_stream(seed, i), scratch);
+			prods.left = scaled_double(sums.left, 0);
+			prods.tree = scaled_double(sums.tree, 0);
+			prods.height = sums.height;
+		} else {
+			prods = shuffle_associate<scaled_double>(as.data(), n, false, s, rand_stream(seed, i),
+			                                         scaled_scratch);
+		}
+		if (rola != NULL) {
+			rola[i] = error_of(op, prods.left.m, prods.left, exact_sum, exact_prod);
+		}
+		if (rora != NULL) {
+			rora[i] = error_of(op, prods.tree.m, prods.tree, exact_sum, exact_prod);
+		}
+		if (rora_height != NULL) {
+			rora_height[i] = (int) prods.height;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,80 @@
+/* A C API over the core of assoc_test, built as libreduce.so, so other
+ * languages can run experiments in memory instead of parsing TSV files.
+ * analysis/reduce_api.c binds it to R with .Call, filling R vectors in
+ * place; see analysis/reduce_api.R.
+ *
+ * Nothing is allocated for the caller: every result goes to buffers the
+ * caller passes in, of the lengths given. Vectors are doubles. A shape is
+ * rapi_shape_words(n) 64-bit words: n, then the bits of tree_shape.hxx, so
+ * a shape applied to a vector of another length is refused.
+ *
+ * With the same seed the numbers, trees and shuffles are those of
+ * assoc_test (which uses seed 42, ASSOC_SEED): rapi_generate fills as it
+ * generates, and rapi_trials draws as its loop does.
+ *
+ * op is RAPI_SUM or RAPI_PROD. Products are evaluated in scaled_double
+ * (scaled_prod.hxx), so they are returned as a mantissa in val and a power
+ * of two in exp2, val * 2^exp2, with val in [0.5, 1) or zero, infinite or
+ * NaN (and exp2 0); with exp2 NULL val is the product as a double, which
+ * may underflow or overflow. Sums have exp2 0.
+ *
+ * The errors are those assoc.R computes, against the exact result: the
+ * exact sum (MPFR, 1000 bits) minus the computed one, or for products
+ * |computed - exact| / |exact|, with the correctly rounded exact product.
+ *
+ * Every function returns 0 on success, or 1 with the reason in
+ * rapi_error(). The generators and rand() are global, so calls must not
+ * run concurrently.
+ */
+#ifndef REDUCE_API_H
+#define REDUCE_API_H
+
+#include <stdint.h>
+
+#define RAPI_SUM 0
+#define RAPI_PROD 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Why the last call failed */
+const char *rapi_error(void);
+
+/* n elements of a distribution (runif[0,1], runif[-1,1], runif[-1000,1000],
+ * rsubn) after set_seed(seed, 0) */
+int rapi_generate(const char *distr, unsigned int seed, long long n, double *out);
+
+/* 64-bit words of a shape over n leaves, with its header */
+long long rapi_shape_words(long long n);
+
+/* count random tree shapes over n leaves, in order after srand(seed), into
+ * bits, count * rapi_shape_words(n) words */
+int rapi_shapes(long long n, unsigned int seed, long long count, uint64_t *bits);
+
+/* a[0..n) reduced left-associatively if shape is NULL, else in shape (one
+ * of rapi_shapes, over n leaves). The height of the tree goes to height, if
+ * not NULL. */
+int rapi_eval(const double *a, long long n, int op, const uint64_t *shape,
+              double *val, double *exp2, long long *height);
+
+/* The exact reduction of a[0..n), rounded to nearest */
+int rapi_exact(const double *a, long long n, int op, double *val, double *exp2);
+
+/* Errors of m results of reducing a[0..n), val[i] * 2^exp2[i] (exp2 may be
+ * NULL), into err */
+int rapi_errors(const double *a, long long n, int op, const double *val,
+                const double *exp2, long long m, double *err);
+
+/* The trials of assoc_test: for each of iters, a random association of a
+ * in order (fora in assoc.R), and a shuffle of a summed left-associatively
+ * (rola) and in another random association (rora). Writes the errors of
+ * each and the heights of both trees; any output may be NULL. */
+int rapi_trials(const double *a, long long n, int op, unsigned int seed, long long iters,
+                double *fora, double *rola, double *rora, int *fora_height, int *rora_height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,270 @@
+/* Timing of MPI reductions, as opposed to the single-shot time columns of
+ * dotprod_mpi. For each reduction, message size and communicator size:
+ * - warm-up calls that are not recorded,
+ * - repetitions separated by MPI_Barrier, each taking the maximum time over
+ *   all ranks (the time until the last rank is done),
+ * - the minimum, percentiles, maximum and mean of those repetitions.
+ * Communicator sizes are the powers of two below N, then N itself. Message
+ * sizes double from <min count> to <max count>. To time another reduction,
+ * add it to bench_ops in main.
+ *
+ * Ops ending in FTZ run with subnormals flushed to zero (subnormal.hxx) on
+ * every rank, which only changes the time of reductions over rsubn or other
+ * data with subnormals, and only where the library reduces in the calling
+ * thread. They are left out where the machine cannot flush.
+ *
+ * The hierarchical reductions of topo_reduce.hxx are timed next to the MPI
+ * ones. Their levels come from the platform named by <topology> in
+ * $TOPO_DIR (default ../topologies), or from shared memory without one.
+ */
+#define USAGE (\
+	"mpirun -np <N> ./reduce_bench <min count> <max count> <reps> <warmup> <distr> <topology> <algorithm>\n"\
+	"<min count> <max count> are the range of elements per reduction\n"\
+	"<reps> is the number of timed calls, <warmup> untimed ones before them\n"\
+	"<distr> is the distribution of the elements. Choices are:\n"\
+	"\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n"\
+	"<topology> is a string for logging, best used with SimGrid, and the platform\n"\
+	"\tthe hierarchical reductions follow\n"\
+	"<algorithm> is a string for logging, best used with SimGrid\n")
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <stdlib.h>
+
+#include "mpi_op.hxx"
+#include "rand.hxx"
+#include "subnormal.hxx"
+#include "topo_reduce.hxx"
+
+#define FLOAT_T double
+
+/* A reduction to time. Running error ops reduce running_error<FLOAT_T>.
+ * Hierarchical ones ignore op and use the levels in bench_bufs. */
+struct bench_op {
+	const char *name;
+	bool all;      // MPI_Allreduce rather than MPI_Reduce to rank 0
+	bool running;
+	MPI_Op op;
+	bool hier;
+	level_tree_t tree;
+	bool ftz;      // With subnormals flushed to zero
+};
+
+struct bench_bufs {
+	std::vector<FLOAT_T> in, out;
+	std::vector<running_error<FLOAT_T> > run_in, run_out;
+	MPI_Datatype run_type;
+	topo_hier_t hier;  // For the communicator being timed
+};
+
+static void reduce_once(const bench_op &op, bench_bufs &b, int count, MPI_Comm comm)
+{
+	if (op.hier && op.all) {
+		topo_allreduce(b.in.data(), b.out.data(), count, b.hier, op.tree);
+	} else if (op.hier) {
+		topo_reduce(b.in.data(), b.out.data(), count, b.hier, op.tree);
+	} else if (op.running && op.all) {
+		MPI_Allreduce(b.run_in.data(), b.run_out.data(), count, b.run_type, op.op, comm);
+	} else if (op.running) {
+		MPI_Reduce(b.run_in.data(), b.run_out.data(), count, b.run_type, op.op, 0, comm);
+	} else if (op.all) {
+		MPI_Allreduce(b.in.data(), b.out.data(), count, MPI_DOUBLE, op.op, comm);
+	} else {
+		MPI_Reduce(b.in.data(), b.out.data(), count, MPI_DOUBLE, op.op, 0, comm);
+	}
+}
+
+/* Time reps calls after warmup untimed ones. Rank 0 gets the per-call
+ * maximum over the ranks of comm in times. */
+static void time_reps(const bench_op &op, bench_bufs &b, int count, MPI_Comm comm,
+                      long reps, long warmup, std::vector<double> &times)
+{
+	long i;
+	int rank;
+	double t, tmax;
+	bool was = fp_flush(op.ftz);
+	MPI_Comm_rank(comm, &rank);
+	times.clear();
+	for (i = 0; i < warmup + reps; i++) {
+		MPI_Barrier(comm);
+		t = MPI_Wtime();
+		reduce_once(op, b, count, comm);
+		t = MPI_Wtime() - t;
+		MPI_Reduce(&t, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+		if (rank == 0 && i >= warmup) {
+			times.push_back(tmax);
+		}
+	}
+	fp_flush(was);
+}
+
+/* Nearest-rank percentile of sorted x, 0 < q <= 1 */
+static double percentile(const std::vector<double> &x, double q)
+{
+	size_t k = (size_t) ceil(q * x.size());
+	return x[k == 0 ? 0 : k - 1];
+}
+
+static double median(const std::vector<double> &x)
+{
+	size_t n = x.size();
+	return n % 2 == 1 ? x[n/2] : (x[n/2 - 1] + x[n/2]) / 2;
+}
+
+int main(int argc, char *argv[])
+{
+	int taskid, numtasks, rc = 0;
+	int mincount, maxcount, count, p;
+	long reps, warmup, i;
+	size_t j, k;
+	double mag = 0.0, mean;
+	FLOAT_T (*rand_flt)(); // Function to generate a random float
+	std::string distr, topo, algo, msg;
+	std::vector<int> sizes;
+	std::vector<double> times;
+	MPI_Op nc_sum_op, run_sum_op;
+	MPI_Comm comm;
+	bench_bufs b;
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_size(MPI_COMM_WORLD, &numtasks);
+	MPI_Comm_rank(MPI_COMM_WORLD, &taskid);
+
+	if (argc != 8) {
+		if (taskid == 0) {
+			fprintf(stderr, "Expected 7 arguments, found %d\n", argc-1);
+			fprintf(stderr, USAGE);
+		}
+		rc = 1;
+		goto done;
+	}
+	mincount = atoi(argv[1]);
+	maxcount = atoi(argv[2]);
+	reps = atol(argv[3]);
+	warmup = atol(argv[4]);
+	distr = argv[5];
+	topo = argv[6];
+	algo = argv[7];
+	if (mincount <= 0 || maxcount < mincount || reps <= 0 || warmup < 0) {
+		if (taskid == 0) {
+			fprintf(stderr, USAGE);
+		}
+		rc = 1;
+		goto done;
+	}
+	if (parse_distr<FLOAT_T>(distr, &mag, &rand_flt) != 0) {
+		if (taskid == 0) {
+			fprintf(stderr, "Unrecognized distribution:\n%s", USAGE);
+		}
+		rc = 1;
+		goto done;
+	}
+
+	if (MPI_Op_create((MPI_User_function *) noncommutative_sum, false, &nc_sum_op) != 0
+			|| running_error_type(&b.run_type) != 0
+			|| MPI_Op_create((MPI_User_function *) running_error_sum, true, &run_sum_op) != 0) {
+		if (taskid == 0) {
+			fprintf(stderr, "Could not create MPI ops\n");
+		}
+		rc = 1;
+		goto done;
+	}
+
+	/* Every rank finds its place in the topology, or none of them time */
+	if (topo_hier_create(topo_dir(), topo, MPI_COMM_WORLD, &b.hier, msg) != 0) {
+		if (taskid == 0) {
+			fprintf(stderr, "%s\n", msg.c_str());
+		}
+		rc = 1;
+		goto done;
+	}
+	topo_hier_free(&b.hier);
+
+	{
+	const bench_op bench_ops[] = {
+		{"MPI Reduce",               false, false, MPI_SUM,    false, LEVEL_LINEAR},
+		{"MPI Allreduce",            true,  false, MPI_SUM,    false, LEVEL_LINEAR},
+		{"MPI noncomm sum",          false, false, nc_sum_op,  false, LEVEL_LINEAR},
+		{"MPI Allreduce noncomm sum", true, false, nc_sum_op,  false, LEVEL_LINEAR},
+		{"MPI running sum",          false, true,  run_sum_op, false, LEVEL_LINEAR},
+		{"MPI Allreduce running sum", true, true,  run_sum_op, false, LEVEL_LINEAR},
+		{"Topology linear",          false, false, MPI_OP_NULL, true, LEVEL_LINEAR},
+		{"Topology binomial",        false, false, MPI_OP_NULL, true, LEVEL_BINOMIAL},
+		{"Topology Allreduce linear", true, false, MPI_OP_NULL, true, LEVEL_LINEAR},
+		{"Topology Allreduce binomial", true, false, MPI_OP_NULL, true, LEVEL_BINOMIAL},
+		{"MPI Reduce FTZ",           false, false, MPI_SUM,    false, LEVEL_LINEAR, true},
+		{"MPI Allreduce FTZ",        true,  false, MPI_SUM,    false, LEVEL_LINEAR, true},
+		{"MPI noncomm sum FTZ",      false, false, nc_sum_op,  false, LEVEL_LINEAR, true},
+	};
+
+	/* Each rank reduces its own values */
+	set_seed(ASSOC_SEED, taskid);
+	b.in.resize(maxcount);
+	b.out.resize(maxcount);
+	b.run_in.resize(maxcount);
+	b.run_out.resize(maxcount);
+	for (i = 0; i < maxcount; i++) {
+		b.in[i] = rand_flt();
+		b.run_in[i] = running_error<FLOAT_T>(b.in[i]);
+	}
+
+	for (p = 2; p < numtasks; p *= 2) {
+		sizes.push_back(p);
+	}
+	sizes.push_back(numtasks);
+
+	if (taskid == 0) {
+		printf("numtasks\tveclen\ttopology\tdistribution\treduction algorithm\torder\treps\twarmup\t"
+		       "time min\ttime p05\ttime p25\ttime median\ttime p75\ttime p95\ttime max\ttime mean\n");
+	}
+	for (k = 0; k < sizes.size(); k++) {
+		p = sizes[k];
+		MPI_Comm_split(MPI_COMM_WORLD, taskid < p ? 0 : MPI_UNDEFINED, taskid, &comm);
+		if (comm == MPI_COMM_NULL) {
+			continue;
+		}
+		/* Can't fail once it worked for MPI_COMM_WORLD */
+		topo_hier_create(topo_dir(), topo, comm, &b.hier, msg);
+		for (count = mincount; count <= maxcount; count *= 2) {
+			for (const bench_op &op : bench_ops) {
+				if (op.ftz && !fp_flush_supported()) {
+					continue;
+				}
+				time_reps(op, b, count, comm, reps, warmup, times);
+				if (taskid != 0) {
+					continue;
+				}
+				std::sort(times.begin(), times.end());
+				mean = 0.0;
+				for (j = 0; j < times.size(); j++) {
+					mean += times[j];
+				}
+				mean /= times.size();
+				printf("%d\t%d\t%s\t%s\t%s\t%s\t%ld\t%ld\t%e\t%e\t%e\t%e\t%e\t%e\t%e\t%e\n",
+					p, count, topo.c_str(), distr.c_str(), algo.c_str(), op.name, reps, warmup,
+					times.front(), percentile(times, 0.05), percentile(times, 0.25),
+					median(times), percentile(times, 0.75), percentile(times, 0.95),
+					times.back(), mean);
+				fflush(stdout);
+			}
+			if (count > maxcount / 2) {
+				break; // Don't overflow
+			}
+		}
+		topo_hier_free(&b.hier);
+		MPI_Comm_free(&comm);
+	}
+	}
+
+	MPI_Op_free(&nc_sum_op);
+	MPI_Op_free(&run_sum_op);
+	MPI_Type_free(&b.run_type);
+
+done:
+	MPI_Finalize();
+	return rc;
+}
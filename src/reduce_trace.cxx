@@ -0,0 +1,173 @@
+/* Tracing the association of MPI reductions. See reduce_trace.hxx */
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mpi.h>
+
+#include "reduce_trace.hxx"
+
+/* Merges run by this rank since trace_clear */
+static std::vector<trace_merge_t> trace_log;
+
+void traced_sum(traced_value_t *in, traced_value_t *inout, int *len, MPI_Datatype *dptr)
+{
+	long int i;
+	trace_merge_t m;
+	for (i = 0; i < *len; ++i) {
+		m.left_first = in->first;
+		m.left_count = in->count;
+		m.right_first = inout->first;
+		m.right_count = inout->count;
+		trace_log.push_back(m);
+		inout->val = in->val + inout->val;
+		inout->first = std::min(in->first, inout->first);
+		inout->count = in->count + inout->count;
+		inout->height = std::max(in->height, inout->height) + 1;
+		in++;
+		inout++;
+	}
+}
+
+int traced_value_type(MPI_Datatype *type)
+{
+	int rc;
+	int lens[2] = {1, 4};
+	MPI_Aint disp[2] = {offsetof(traced_value_t, val), offsetof(traced_value_t, first)};
+	MPI_Datatype types[2] = {MPI_DOUBLE, MPI_INT32_T};
+	MPI_Datatype t;
+	rc = MPI_Type_create_struct(2, lens, disp, types, &t);
+	if (rc != MPI_SUCCESS) {
+		return rc;
+	}
+	rc = MPI_Type_create_resized(t, 0, sizeof(traced_value_t), type);
+	MPI_Type_free(&t);
+	if (rc != MPI_SUCCESS) {
+		return rc;
+	}
+	return MPI_Type_commit(type);
+}
+
+traced_value_t trace_leaf(double x, int rank)
+{
+	traced_value_t v;
+	v.val = x;
+	v.first = rank;
+	v.count = 1;
+	v.height = 0;
+	v.pad = 0;
+	return v;
+}
+
+void trace_clear()
+{
+	trace_log.clear();
+}
+
+void trace_gather(MPI_Comm comm, int root, std::vector<trace_merge_t> &all)
+{
+	int rank, size, mine, p;
+	const int ints = sizeof(trace_merge_t) / sizeof(int32_t);
+	std::vector<int> counts, displs;
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	mine = (int) trace_log.size() * ints;
+	if (rank == root) {
+		counts.resize(size);
+		displs.resize(size);
+	}
+	MPI_Gather(&mine, 1, MPI_INT, counts.data(), 1, MPI_INT, root, comm);
+	if (rank == root) {
+		for (p = 0; p < size; p++) {
+			displs[p] = p == 0 ? 0 : displs[p-1] + counts[p-1];
+		}
+		all.resize((displs[size-1] + counts[size-1]) / ints);
+	}
+	MPI_Gatherv(trace_log.data(), mine, MPI_INT32_T, all.data(), counts.data(),
+	            displs.data(), MPI_INT32_T, root, comm);
+}
+
+/* Nodes are leaves 0..n-1, then inner nodes in the order they are built */
+struct trace_node {
+	long long left, right;
+};
+
+int trace_tree(int n, const std::vector<trace_merge_t> &merges, reduce_tree_t *t, std::string &msg)
+{
+	std::vector<trace_merge_t> m(merges);
+	std::vector<trace_node> node(n, trace_node{-1, -1});
+	std::unordered_map<long long, long long> named;  // first * (n+1) + count
+	std::vector<std::pair<long long, int> > stack;   // Node, and what is done
+	long long key, l, r, root, d, v;
+	size_t i;
+	int k;
+
+	t->height = 0;
+	t->depth.assign(n, 0);
+	t->encoding.clear();
+	t->duplicates = 0;
+	t->conflicts = 0;
+	for (k = 0; k < n; k++) {
+		named[(long long) k * (n + 1) + 1] = k;
+	}
+	/* Children always have fewer leaves than their parent */
+	std::sort(m.begin(), m.end(), [](const trace_merge_t &a, const trace_merge_t &b) {
+		return a.left_count + a.right_count < b.left_count + b.right_count;
+	});
+	for (i = 0; i < m.size(); i++) {
+		auto lf = named.find((long long) m[i].left_first * (n + 1) + m[i].left_count);
+		auto rf = named.find((long long) m[i].right_first * (n + 1) + m[i].right_count);
+		if (lf == named.end() || rf == named.end()) {
+			msg = "Merge of a subtree that was never built";
+			return 1;
+		}
+		l = lf->second;
+		r = rf->second;
+		key = (long long) std::min(m[i].left_first, m[i].right_first) * (n + 1)
+		      + m[i].left_count + m[i].right_count;
+		auto have = named.find(key);
+		if (have == named.end()) {
+			named[key] = (long long) node.size();
+			node.push_back(trace_node{l, r});
+		} else if (node[have->second].left == l && node[have->second].right == r) {
+			t->duplicates++;
+		} else {
+			t->conflicts++;
+		}
+	}
+	auto top = named.find((long long) n);  // first 0, count n
+	if (top == named.end()) {
+		msg = "Merges do not join all " + std::to_string(n) + " ranks";
+		return 1;
+	}
+	root = top->second;
+
+	/* Depth of each leaf and the nested pairs, without recursion since a
+	 * linear reduction over 10^4 ranks is 10^4 deep */
+	stack.push_back(std::make_pair(root, 0));
+	while (!stack.empty()) {
+		v = stack.back().first;
+		k = stack.back().second;
+		d = (long long) stack.size() - 1;
+		if (v < n) {
+			t->depth[v] = d;
+			t->height = std::max(t->height, d);
+			t->encoding += std::to_string(v);
+			stack.pop_back();
+		} else if (k == 0) {
+			t->encoding += '(';
+			stack.back().second = 1;
+			stack.push_back(std::make_pair(node[v].left, 0));
+		} else if (k == 1) {
+			t->encoding += ',';
+			stack.back().second = 2;
+			stack.push_back(std::make_pair(node[v].right, 0));
+		} else {
+			t->encoding += ')';
+			stack.pop_back();
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+/* Recover the association an MPI library actually used for a reduction.
+ * Each rank sends a traced_value instead of a double. The subtree a
+ * partial sum stands for is named by its lowest rank and its number of
+ * leaves: subtrees of one reduction are disjoint, and the one with a given
+ * lowest rank only grows, so (first, count) never names two different
+ * subtrees. Whenever traced_sum combines two partials, the rank running it
+ * logs the pair of names. Gathering the logs gives every inner node of the
+ * tree with its children, in whatever order the library ran them.
+ *
+ * The payload is 24 bytes whatever the number of ranks, and a reduction
+ * over P ranks logs P-1 merges in total, so tracing stays cheap at 10^4
+ * ranks and more. Trace with count 1: segmented algorithms may combine the
+ * elements of longer messages in different trees.
+ */
+#ifndef REDUCE_TRACE_HXX
+#define REDUCE_TRACE_HXX
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+typedef struct traced_value {
+	double val;
+	int32_t first;   // Lowest rank in the subtree
+	int32_t count;   // Ranks in the subtree
+	int32_t height;  // Of the subtree, 0 for one rank's value
+	int32_t pad;
+} traced_value_t;
+
+/* in was combined with inout, in on the left as MPI_Op defines it */
+typedef struct trace_merge {
+	int32_t left_first, left_count;
+	int32_t right_first, right_count;
+} trace_merge_t;
+
+typedef struct reduce_tree {
+	long long height;
+	std::vector<long long> depth;  // Of each rank's leaf
+	std::string encoding;          // Nested pairs of ranks, e.g. ((0,1),(2,3))
+	long long duplicates;          // Merges logged more than once
+	long long conflicts;           // Merges naming a subtree already built otherwise
+} reduce_tree_t;
+
+/* Sum that also logs the merge. Create it commutative or not to trace the
+ * algorithm the library picks for either. */
+void traced_sum(traced_value_t *in, traced_value_t *inout, int *len, MPI_Datatype *dptr);
+int traced_value_type(MPI_Datatype *type);
+
+traced_value_t trace_leaf(double x, int rank);
+/* Forget the merges this rank has logged */
+void trace_clear();
+/* Merges logged by all ranks of comm, on root */
+void trace_gather(MPI_Comm comm, int root, std::vector<trace_merge_t> &all);
+/* The tree over n ranks from merges. 0 on success, 1 with a reason in msg
+ * if they do not join all n ranks into one tree. */
+int trace_tree(int n, const std::vector<trace_merge_t> &merges, reduce_tree_t *t, std::string &msg);
+
+#endif
@@ -0,0 +1,323 @@
+/* Run-time choice of reduction. See reduce_tune.hxx */
+#include <algorithm>
+#include <cmath>
+
+#include "error_semantics.hxx"
+#include "mpi_op.hxx"
+#include "reduce_trace.hxx"
+#include "reduce_tune.hxx"
+
+/* Time and height of every candidate for one message */
+struct tune_measured {
+	int count;
+	bool all;
+	double time[TUNE_ALGOS];
+	long long height[TUNE_ALGOS];
+};
+
+/* A choice made from them for one budget */
+struct tune_decided {
+	int count;
+	bool all;
+	tune_budget_t budget;
+	tune_algo_t algo;
+	double err[TUNE_ALGOS];
+};
+
+/* Attribute of a communicator */
+struct tune_cache {
+	std::vector<tune_measured> measured;
+	std::vector<tune_decided> decided;
+	std::vector<double> scratch;  // Gathered partials, for TUNE_GATHER
+};
+
+static int tune_keyval = MPI_KEYVAL_INVALID;
+static MPI_Op tune_nc_op = MPI_OP_NULL;
+
+const char *tune_algo_name(tune_algo_t algo)
+{
+	switch (algo) {
+	case TUNE_MPI:           return "MPI";
+	case TUNE_MPI_NONCOMM:   return "MPI noncomm";
+	case TUNE_GATHER:        return "Gather";
+	case TUNE_TOPO_LINEAR:   return "Topology linear";
+	case TUNE_TOPO_BINOMIAL: return "Topology binomial";
+	default:                 return "none";
+	}
+}
+
+static int tune_delete(MPI_Comm comm, int keyval, void *attr, void *extra)
+{
+	delete (tune_cache *) attr;
+	return MPI_SUCCESS;
+}
+
+static tune_cache *cache_of(MPI_Comm comm, bool create)
+{
+	tune_cache *c;
+	int found;
+	if (tune_keyval == MPI_KEYVAL_INVALID) {
+		if (!create) {
+			return NULL;
+		}
+		MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, tune_delete, &tune_keyval, NULL);
+	}
+	MPI_Comm_get_attr(comm, tune_keyval, &c, &found);
+	if (found) {
+		return c;
+	}
+	if (!create) {
+		return NULL;
+	}
+	c = new tune_cache();
+	MPI_Comm_set_attr(comm, tune_keyval, c);
+	return c;
+}
+
+static bool same_budget(const tune_budget_t &a, const tune_budget_t &b)
+{
+	return a.n == b.n && a.x_lb == b.x_lb && a.x_ub == b.x_ub && a.y_lb == b.y_lb
+		&& a.y_ub == b.y_ub && a.err == b.err && a.reproducible == b.reproducible;
+}
+
+static bool available(tune_algo_t algo, const topo_hier_t *hier)
+{
+	return hier != NULL || (algo != TUNE_TOPO_LINEAR && algo != TUNE_TOPO_BINOMIAL);
+}
+
+static void run(tune_algo_t algo, bool all, const double *in, double *out, int count,
+                MPI_Comm comm, topo_hier_t *hier, std::vector<double> &scratch)
+{
+	int rank, size, p, i;
+	switch (algo) {
+	case TUNE_MPI:
+	case TUNE_MPI_NONCOMM:
+		if (all) {
+			MPI_Allreduce(in, out, count, MPI_DOUBLE,
+			              algo == TUNE_MPI ? MPI_SUM : tune_nc_op, comm);
+		} else {
+			MPI_Reduce(in, out, count, MPI_DOUBLE,
+			           algo == TUNE_MPI ? MPI_SUM : tune_nc_op, 0, comm);
+		}
+		break;
+	case TUNE_GATHER:
+		MPI_Comm_rank(comm, &rank);
+		MPI_Comm_size(comm, &size);
+		scratch.resize(rank == 0 ? (size_t) count * size : 0);
+		MPI_Gather(in, count, MPI_DOUBLE, scratch.data(), count, MPI_DOUBLE, 0, comm);
+		if (rank == 0) {
+			for (i = 0; i < count; i++) {
+				out[i] = scratch[i];
+				for (p = 1; p < size; p++) {
+					out[i] += scratch[(size_t) p * count + i];
+				}
+			}
+		}
+		if (all) {
+			MPI_Bcast(out, count, MPI_DOUBLE, 0, comm);
+		}
+		break;
+	case TUNE_TOPO_LINEAR:
+	case TUNE_TOPO_BINOMIAL:
+		if (all) {
+			topo_allreduce(in, out, count, *hier,
+			               algo == TUNE_TOPO_LINEAR ? LEVEL_LINEAR : LEVEL_BINOMIAL);
+		} else {
+			topo_reduce(in, out, count, *hier,
+			            algo == TUNE_TOPO_LINEAR ? LEVEL_LINEAR : LEVEL_BINOMIAL);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* Height of the tree the library used, the tallest over elements and ranks */
+static long long traced_height(bool commutative, bool all, const double *in, int count,
+                               MPI_Comm comm)
+{
+	int rank, i, mine = 0, tallest;
+	MPI_Datatype type;
+	MPI_Op op;
+	std::vector<traced_value_t> leaves(count), out(count);
+
+	MPI_Comm_rank(comm, &rank);
+	traced_value_type(&type);
+	MPI_Op_create((MPI_User_function *) traced_sum, commutative, &op);
+	for (i = 0; i < count; i++) {
+		leaves[i] = trace_leaf(in[i], rank);
+	}
+	if (all) {
+		MPI_Allreduce(leaves.data(), out.data(), count, type, op, comm);
+	} else {
+		MPI_Reduce(leaves.data(), out.data(), count, type, op, 0, comm);
+	}
+	trace_clear();
+	for (i = 0; i < count && (all || rank == 0); i++) {
+		mine = std::max(mine, (int) out[i].height);
+	}
+	MPI_Allreduce(&mine, &tallest, 1, MPI_INT, MPI_MAX, comm);
+	MPI_Op_free(&op);
+	MPI_Type_free(&type);
+	return tallest;
+}
+
+static void measure(tune_measured &m, const double *in, int count, MPI_Comm comm,
+                    topo_hier_t *hier, std::vector<double> &scratch)
+{
+	int a, r, size;
+	double t, mine[TUNE_ALGOS];
+	std::vector<double> out(count), times(TUNE_REPS);
+
+	MPI_Comm_size(comm, &size);
+	if (tune_nc_op == MPI_OP_NULL) {
+		MPI_Op_create((MPI_User_function *) noncommutative_sum, false, &tune_nc_op);
+	}
+	for (a = 0; a < TUNE_ALGOS; a++) {
+		tune_algo_t algo = (tune_algo_t) a;
+		mine[a] = INFINITY;
+		m.height[a] = -1;
+		if (!available(algo, hier)) {
+			continue;
+		}
+		for (r = -TUNE_WARMUP; r < TUNE_REPS; r++) {
+			MPI_Barrier(comm);
+			t = MPI_Wtime();
+			run(algo, m.all, in, out.data(), count, comm, hier, scratch);
+			t = MPI_Wtime() - t;
+			if (r >= 0) {
+				times[r] = t;
+			}
+		}
+		std::nth_element(times.begin(), times.begin() + TUNE_REPS / 2, times.end());
+		mine[a] = times[TUNE_REPS / 2];
+		switch (algo) {
+		case TUNE_MPI:
+			m.height[a] = traced_height(true, m.all, in, count, comm);
+			break;
+		case TUNE_MPI_NONCOMM:
+			m.height[a] = traced_height(false, m.all, in, count, comm);
+			break;
+		case TUNE_GATHER:
+			m.height[a] = size - 1;
+			break;
+		default:
+			m.height[a] = topo_height(*hier, algo == TUNE_TOPO_LINEAR ? LEVEL_LINEAR : LEVEL_BINOMIAL);
+			break;
+		}
+	}
+	/* Every rank decides from the same times */
+	MPI_Allreduce(mine, m.time, TUNE_ALGOS, MPI_DOUBLE, MPI_MAX, comm);
+}
+
+/* Bound on the error a tree of the given height adds to each element when
+ * reducing size partial dot products, over that of the partials themselves */
+static double predict(const tune_budget_t &b, int size, long long height)
+{
+	Scal_E<double> local = dot_e(Vec_E<double>(b.n, b.x_lb, b.x_ub, 0.0),
+	                             Vec_E<double>(b.n, b.y_lb, b.y_ub, 0.0));
+	MPFR_T_DEFAULT mag = std::max(abs(MPFR_T_DEFAULT(local.lb())), abs(MPFR_T_DEFAULT(local.ub())))
+		+ local.error_ub();
+	MPFR_T_DEFAULT err = size * mag * gamma<double>(height);
+	return err.convert_to<double>();
+}
+
+static void decide(tune_decided &d, const tune_measured &m, int size)
+{
+	int a, best = -1, least = -1;
+	for (a = 0; a < TUNE_ALGOS; a++) {
+		d.err[a] = m.height[a] < 0 ? INFINITY : predict(d.budget, size, m.height[a]);
+		if (std::isinf(m.time[a])
+				|| (d.budget.reproducible && (a == TUNE_MPI || a == TUNE_MPI_NONCOMM))) {
+			continue;
+		}
+		if (d.err[a] <= d.budget.err && (best < 0 || m.time[a] < m.time[best])) {
+			best = a;
+		}
+		if (least < 0 || d.err[a] < d.err[least]
+				|| (d.err[a] == d.err[least] && m.time[a] < m.time[least])) {
+			least = a;
+		}
+	}
+	d.algo = (tune_algo_t) (best >= 0 ? best : least);
+}
+
+static tune_algo_t tuned(bool all, const double *in, double *out, int count, MPI_Comm comm,
+                         const tune_budget_t &budget, topo_hier_t *hier)
+{
+	tune_cache *c = cache_of(comm, true);
+	tune_measured *m = NULL;
+	tune_decided d;
+	int size;
+	size_t i;
+
+	for (i = 0; i < c->decided.size(); i++) {
+		if (c->decided[i].count == count && c->decided[i].all == all
+				&& same_budget(c->decided[i].budget, budget)) {
+			run(c->decided[i].algo, all, in, out, count, comm, hier, c->scratch);
+			return c->decided[i].algo;
+		}
+	}
+	for (i = 0; i < c->measured.size(); i++) {
+		if (c->measured[i].count == count && c->measured[i].all == all) {
+			m = &c->measured[i];
+		}
+	}
+	if (m == NULL) {
+		c->measured.push_back(tune_measured());
+		m = &c->measured.back();
+		m->count = count;
+		m->all = all;
+		measure(*m, in, count, comm, hier, c->scratch);
+	}
+	MPI_Comm_size(comm, &size);
+	d.count = count;
+	d.all = all;
+	d.budget = budget;
+	decide(d, *m, size);
+	c->decided.push_back(d);
+	run(d.algo, all, in, out, count, comm, hier, c->scratch);
+	return d.algo;
+}
+
+tune_algo_t tuned_reduce(const double *in, double *out, int count, MPI_Comm comm,
+                         const tune_budget_t &budget, topo_hier_t *hier)
+{
+	return tuned(false, in, out, count, comm, budget, hier);
+}
+
+tune_algo_t tuned_allreduce(const double *in, double *out, int count, MPI_Comm comm,
+                            const tune_budget_t &budget, topo_hier_t *hier)
+{
+	return tuned(true, in, out, count, comm, budget, hier);
+}
+
+tune_algo_t tune_report(MPI_Comm comm, int count, bool all, const tune_budget_t &budget,
+                        std::vector<tune_candidate_t> &c)
+{
+	tune_cache *cache = cache_of(comm, false);
+	const tune_measured *m = NULL;
+	size_t i;
+	int a;
+
+	c.clear();
+	if (cache == NULL) {
+		return TUNE_ALGOS;
+	}
+	for (i = 0; i < cache->measured.size(); i++) {
+		if (cache->measured[i].count == count && cache->measured[i].all == all) {
+			m = &cache->measured[i];
+		}
+	}
+	for (i = 0; m != NULL && i < cache->decided.size(); i++) {
+		const tune_decided &d = cache->decided[i];
+		if (d.count != count || d.all != all || !same_budget(d.budget, budget)) {
+			continue;
+		}
+		for (a = 0; a < TUNE_ALGOS; a++) {
+			c.push_back(tune_candidate_t{(tune_algo_t) a, m->time[a], m->height[a], d.err[a]});
+		}
+		return d.algo;
+	}
+	return TUNE_ALGOS;
+}
@@ -0,0 +1,92 @@
+/* Pick a reduction at run time: the fastest one whose predicted error is
+ * within a budget, measured once per communicator and message size.
+ *
+ * The candidates are what can be switched without relaunching:
+ * - TUNE_MPI          MPI_Reduce/MPI_Allreduce with MPI_SUM, in whatever
+ *                     algorithm the library was started with (--cfg=smpi/
+ *                     reduce:<algo> under SimGrid, MCA parameters in Open
+ *                     MPI). Changing it needs a new launch, so compare
+ *                     vendor algorithms with one run each.
+ * - TUNE_MPI_NONCOMM  the same with a noncommutative sum, which MPI has to
+ *                     combine in rank order: the same bits on every run of
+ *                     the same library and number of ranks
+ * - TUNE_GATHER       gather to rank 0, add in rank order, broadcast: the
+ *                     same bits with any MPI library
+ * - TUNE_TOPO_LINEAR, TUNE_TOPO_BINOMIAL  topo_reduce along the machine,
+ *                     the same bits with any MPI library on one topology
+ *
+ * The first call for a communicator, message size and reduce or allreduce
+ * runs every candidate TUNE_WARMUP + TUNE_REPS times on the caller's data;
+ * each rank takes its median time and the largest of those is kept. The
+ * height of the tree of each is known, or for TUNE_MPI and TUNE_MPI_NONCOMM
+ * traced once with reduce_trace (the tallest over elements and ranks; the
+ * traced values are three times the bytes, so a library choosing by size
+ * may pick otherwise).
+ * These measurements are cached on the communicator as an MPI attribute.
+ *
+ * The error of each is predicted as in error_semantics: dot_e bounds every
+ * rank's local dot product of budget.n elements, and with it max|partial|;
+ * a tree of height h over p partials then adds gamma_h p max|partial|.
+ * Only that added error is predicted and held to the budget: the local
+ * dot products are the same whichever candidate sums them, and for long
+ * slices their error (p dot_e) is orders of magnitude larger than what
+ * any tree adds, so a budget on the total would hardly tell candidates
+ * apart. The choice for a budget is cached too, so later calls cost one
+ * attribute lookup and a search.
+ *
+ * All calls are collective: every rank must pass the same count, budget
+ * and hierarchy, or ranks pick different reductions and deadlock.
+ */
+#ifndef REDUCE_TUNE_HXX
+#define REDUCE_TUNE_HXX
+
+#include <vector>
+#include <mpi.h>
+
+#include "topo_reduce.hxx"
+
+#define TUNE_WARMUP 2
+#define TUNE_REPS 10
+
+typedef enum tune_algo {
+	TUNE_MPI,
+	TUNE_MPI_NONCOMM,
+	TUNE_GATHER,
+	TUNE_TOPO_LINEAR,
+	TUNE_TOPO_BINOMIAL,
+	TUNE_ALGOS
+} tune_algo_t;
+
+/* What is reduced, and how wrong the result may be: on every rank a dot
+ * product of n elements of x in [x_lb, x_ub] and y in [y_lb, y_ub] */
+typedef struct tune_budget {
+	long long n;
+	double x_lb, x_ub, y_lb, y_ub;
+	double err;        // Largest error the reduction may add to each element
+	bool reproducible; // Only candidates giving the same bits with any MPI library
+} tune_budget_t;
+
+typedef struct tune_candidate {
+	tune_algo_t algo;
+	double time;       // Largest median seconds over ranks; infinite if it can't run
+	long long height;  // Of its reduction tree
+	double err;        // Predicted error the reduction adds, for the budget
+} tune_candidate_t;
+
+const char *tune_algo_name(tune_algo_t algo);
+
+/* Sum of count doubles of in into out on rank 0 of comm, or on every rank,
+ * by the candidate chosen for budget. hier, created for comm, makes the
+ * topology candidates available; it may be NULL. When no candidate is
+ * within the budget the one with the least error is used. Returns it. */
+tune_algo_t tuned_reduce(const double *in, double *out, int count, MPI_Comm comm,
+                         const tune_budget_t &budget, topo_hier_t *hier);
+tune_algo_t tuned_allreduce(const double *in, double *out, int count, MPI_Comm comm,
+                            const tune_budget_t &budget, topo_hier_t *hier);
+
+/* What the choice for these arguments was made from, after a call with
+ * them. Local. Returns the choice, or TUNE_ALGOS if there was no call. */
+tune_algo_t tune_report(MPI_Comm comm, int count, bool all, const tune_budget_t &budget,
+                        std::vector<tune_candidate_t> &c);
+
+#endif
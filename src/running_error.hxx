@@ -0,0 +1,92 @@
+/* A value carried with a running bound on its absolute error, as in the
+ * running error analysis of Higham, Accuracy and Stability of Numerical
+ * Algorithms, section 3.3. Unlike dot_e or dot_bound, the bound is computed
+ * from the values actually reduced, so it is usually far tighter than the
+ * a-priori one and costs about as much again as the plain operation.
+ *
+ * fl(a+b) = (a+b)/(1+d) with |d| <= u gives |fl(a+b) - (a+b)| <= u|fl(a+b)|;
+ * sums that underflow are exact. Products that underflow are not, so they
+ * follow fl(ab) = ab/(1+d) + e with |e| <= eta = denorm_min/2, for a bound
+ * of u|fl(ab)| + eta; eta itself rounds to 0, so denorm_min is added
+ * instead. The bound itself is evaluated in FLOAT_T and
+ * scaled by (1 + 3 eps) per operation so that its own rounding never makes
+ * it understate; underflow of the bound itself is not accounted for.
+ *
+ * The type has the operators and isnan that random_reduction_tree needs, and
+ * the layout of FLOAT_T[2] so it can be sent as an MPI datatype (mpi_op.hxx).
+ */
+#ifndef RUNNING_ERROR_HXX
+#define RUNNING_ERROR_HXX
+
+#include <cmath>
+#include <limits>
+
+template <typename FLOAT_T>
+class running_error {
+	public:
+		FLOAT_T val;  // Computed value
+		FLOAT_T err;  // Bound on |val - exact value|
+		running_error() : val(0), err(0) { };
+		running_error(FLOAT_T x) : val(x), err(0) { };
+		running_error(FLOAT_T x, FLOAT_T e) : val(x), err(e) { };
+		running_error& operator+=(const running_error &b)
+		{
+			FLOAT_T s = val + b.val;
+			/* Adding zero is exact */
+			FLOAT_T r = (val == 0 || b.val == 0) ? 0 : u_ * std::fabs(s);
+			err = (err + b.err + r) * scale_;
+			val = s;
+			return *this;
+		}
+		running_error& operator*=(const running_error &b)
+		{
+			FLOAT_T p = val * b.val;
+			err = (std::fabs(val) * b.err + std::fabs(b.val) * err + err * b.err
+			       + u_ * std::fabs(p) + eta_) * scale_;
+			val = p;
+			return *this;
+		}
+	private:
+		static constexpr FLOAT_T u_ = std::numeric_limits<FLOAT_T>::epsilon() / 2;
+		static constexpr FLOAT_T scale_ = 1 + 3 * std::numeric_limits<FLOAT_T>::epsilon();
+		static constexpr FLOAT_T eta_ = std::numeric_limits<FLOAT_T>::denorm_min();
+};
+
+template <typename FLOAT_T>
+constexpr FLOAT_T running_error<FLOAT_T>::u_;
+template <typename FLOAT_T>
+constexpr FLOAT_T running_error<FLOAT_T>::scale_;
+template <typename FLOAT_T>
+constexpr FLOAT_T running_error<FLOAT_T>::eta_;
+
+template <typename FLOAT_T>
+running_error<FLOAT_T> operator+(running_error<FLOAT_T> a, const running_error<FLOAT_T> &b)
+{
+	return a += b;
+}
+
+template <typename FLOAT_T>
+running_error<FLOAT_T> operator*(running_error<FLOAT_T> a, const running_error<FLOAT_T> &b)
+{
+	return a *= b;
+}
+
+/* random_reduction_tree marks unevaluated nodes with NaN */
+template <typename FLOAT_T>
+bool isnan(const running_error<FLOAT_T> &a)
+{
+	return std::isnan(a.val);
+}
+
+/* Left-associative dot product with a running error bound */
+template <typename FLOAT_T>
+running_error<FLOAT_T> running_dot(const FLOAT_T *a, const FLOAT_T *b, long long n)
+{
+	running_error<FLOAT_T> acc;
+	for (long long i = 0; i < n; i++) {
+		acc += running_error<FLOAT_T>(a[i]) * running_error<FLOAT_T>(b[i]);
+	}
+	return acc;
+}
+
+#endif
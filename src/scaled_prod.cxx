@@ -0,0 +1,187 @@
+/* Products with a separate exponent. See scaled_prod.hxx */
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <gmp.h>
+
+#include "scaled_prod.hxx"
+
+/* Significands go to GMP as unsigned longs */
+static_assert(sizeof(unsigned long) >= 8, "unsigned long must hold 53 bits");
+
+scaled_double scaled_left_prod(const double *a, long long n)
+{
+	double m[SCALED_BLOCK];
+	scaled_double acc(1.0);
+	long long i, j, len;
+	int64_t e;
+	uint64_t u;
+	int k, plain;
+
+	for (i = 0; i < n; i += SCALED_BLOCK) {
+		len = std::min((long long) SCALED_BLOCK, n - i);
+		/* Mantissas and exponents of normal numbers by their bits, without
+		 * branches so the loop vectorizes; a block with zeros, subnormals,
+		 * infinities or NaN is done again with frexp */
+		e = 0;
+		plain = 1;
+		for (j = 0; j < len; j++) {
+			memcpy(&u, &a[i + j], sizeof(u));
+			int64_t f = (int64_t) ((u >> 52) & 0x7ff);
+			plain &= f != 0 && f != 0x7ff;
+			u = (u & 0x800fffffffffffffULL) | 0x3fe0000000000000ULL;
+			memcpy(&m[j], &u, sizeof(u));
+			e += f - 1022;
+		}
+		if (!plain) {
+			e = 0;
+			for (j = 0; j < len; j++) {
+				m[j] = std::frexp(a[i + j], &k);
+				e += std::isfinite(a[i + j]) ? k : 0;
+			}
+		}
+		/* In order, as acc * a[i] would be */
+		for (j = 0; j < len; j++) {
+			acc.m *= m[j];
+		}
+		acc.e += e;
+		acc.renormalize();
+	}
+	return acc;
+}
+
+/* Product of sig[lo..hi) into out, which is initialized */
+static void mpz_prod(const std::vector<unsigned long> &sig, size_t lo, size_t hi, mpz_t out)
+{
+	mpz_t right;
+	size_t i, mid;
+	if (hi - lo <= 16) {
+		mpz_set_ui(out, 1);
+		for (i = lo; i < hi; i++) {
+			mpz_mul_ui(out, out, sig[i]);
+		}
+		return;
+	}
+	/* Balanced, so the big multiplications are of equal sizes */
+	mid = lo + (hi - lo) / 2;
+	mpz_init(right);
+	mpz_prod(sig, lo, mid, out);
+	mpz_prod(sig, mid, hi, right);
+	mpz_mul(out, out, right);
+	mpz_clear(right);
+}
+
+scaled_double scaled_exact_prod(const double *a, long long n)
+{
+	std::vector<unsigned long> sig;
+	scaled_double r;
+	double f, special = 1.0, sign = 1.0;
+	uint64_t s, top;
+	int64_t e = 0;
+	size_t bits, shift;
+	int k, tz;
+	bool sticky;
+	mpz_t p, q;
+
+	/* a[i] = sig * 2^k exactly, with sig odd */
+	sig.reserve(n);
+	for (long long i = 0; i < n; i++) {
+		if (a[i] == 0 || !std::isfinite(a[i])) {
+			special *= a[i];
+			continue;
+		}
+		f = std::frexp(a[i], &k);
+		sign = f < 0 ? -sign : sign;
+		s = (uint64_t) std::ldexp(std::fabs(f), 53);
+		tz = __builtin_ctzll(s);
+		sig.push_back((unsigned long) (s >> tz));
+		e += k - 53 + tz;
+	}
+	if (special != 1.0) {
+		return scaled_double(sign * special);
+	}
+
+	mpz_init(p);
+	mpz_init(q);
+	mpz_prod(sig, 0, sig.size(), p);
+	bits = mpz_sizeinbase(p, 2);
+	if (bits <= 53) {
+		r = scaled_double(sign * mpz_get_d(p), e);
+	} else {
+		/* The top 54 bits, whether any below them are set, and round to
+		 * nearest even. 2^53 after rounding up is still exact. */
+		shift = bits - 54;
+		mpz_tdiv_q_2exp(q, p, shift);
+		top = mpz_get_ui(q);
+		sticky = mpz_scan1(p, 0) < shift;
+		s = top >> 1;
+		if ((top & 1) && (sticky || (s & 1))) {
+			s++;
+		}
+		r = scaled_double(sign * (double) s, e + (int64_t) shift + 1);
+	}
+	mpz_clear(p);
+	mpz_clear(q);
+	r.renormalize();
+	return r;
+}
+
+double scaled_rel_error(const scaled_double &x, const scaled_double &exact)
+{
+	scaled_double a = x, b = exact;
+	if (std::isnan(a.m) || std::isnan(b.m)) {
+		return NAN;
+	}
+	if (b.m == 0 || !std::isfinite(b.m)) {
+		return a.m == b.m ? 0.0 : INFINITY;
+	}
+	if (a.m == 0) {
+		return 1.0;
+	}
+	if (!std::isfinite(a.m)) {
+		return INFINITY;
+	}
+	a.renormalize();
+	b.renormalize();
+	return std::fabs(std::ldexp(a.m, (int) std::max<int64_t>(std::min<int64_t>(a.e - b.e, 4096), -4096))
+	                 - b.m) / std::fabs(b.m);
+}
+
+std::string scaled_hex(const scaled_double &x)
+{
+	scaled_double a = x;
+	char buf[64];
+	a.renormalize();
+	if (a.m == 0 || !std::isfinite(a.m)) {
+		snprintf(buf, sizeof(buf), "%a", a.m);
+		return buf;
+	}
+	/* %a of the mantissa in [1, 2), then the exponent */
+	snprintf(buf, sizeof(buf), "%a", 2 * a.m);
+	*strchr(buf, 'p') = '\0';
+	return std::string(buf) + "p" + (a.e - 1 >= 0 ? "+" : "") + std::to_string(a.e - 1);
+}
+
+std::string scaled_dec(const scaled_double &x)
+{
+	scaled_double a = x;
+	long double l, mant;
+	long long ex;
+	char buf[64];
+	a.renormalize();
+	if (a.m == 0 || !std::isfinite(a.m)) {
+		snprintf(buf, sizeof(buf), "%.11e", a.m);
+		return buf;
+	}
+	/* log10 of the value, in long double so the fraction keeps its digits
+	 * for exponents in the millions */
+	l = log10l(fabsl(a.m)) + (long double) a.e * log10l(2.0L);
+	ex = (long long) floorl(l);
+	mant = powl(10.0L, l - ex);
+	if (mant >= 9.999999999995L) {
+		mant /= 10;
+		ex++;
+	}
+	snprintf(buf, sizeof(buf), "%s%.11Lfe%+lld", a.m < 0 ? "-" : "", mant, ex);
+	return buf;
+}
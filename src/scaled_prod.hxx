@@ -0,0 +1,124 @@
+/* Products of many doubles without overflow or underflow.
+ *
+ * The product of 2M elements of runif[0,1] is about 2^-2885000, far below
+ * the smallest subnormal, so a product reduction in double is zero after a
+ * thousand or so elements, and in MPFR it is slow. scaled_double is a
+ * double mantissa with an exponent of its own in an int64_t, value
+ * m * 2^e. Multiplying multiplies the mantissas and adds the exponents,
+ * and the mantissa is brought back to [0.5, 1) with frexp whenever it
+ * leaves [2^-SCALED_RANGE, 2^SCALED_RANGE]. A product of two mantissas in
+ * that range can't overflow or underflow, and scaling by a power of two is
+ * exact, so every product rounds as it would in a double with an unbounded
+ * exponent: the error is that of the order of the products alone.
+ *
+ * - scaled_double has the operators and isnan that random_reduction_tree
+ *   and shape_eval need, and is sent to MPI as scaled_type (mpi_op.hxx).
+ *   Adding aligns to the larger exponent, which is only exact when the
+ *   exponents are within about 1000 of each other.
+ * - scaled_left_prod multiplies left-associatively as a loop over doubles
+ *   does, splitting each element by its bits and renormalizing once every
+ *   SCALED_BLOCK elements.
+ * - scaled_exact_prod is the correctly rounded product: the integer
+ *   significands multiplied exactly with GMP in a balanced tree, rounded
+ *   to nearest even once.
+ * Zeros, infinities and NaN give what they would give in double.
+ */
+#ifndef SCALED_PROD_HXX
+#define SCALED_PROD_HXX
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <string>
+
+/* Mantissas are kept within 2^-SCALED_RANGE and 2^SCALED_RANGE */
+#define SCALED_RANGE 256
+/* Elements scaled_left_prod multiplies between renormalizations. Each
+ * mantissa is in [0.5, 1), so the product stays above 2^-(SCALED_BLOCK+1). */
+#define SCALED_BLOCK 256
+
+/* 2^k, for the constants */
+constexpr double scaled_pow2(int k)
+{
+	return k == 0 ? 1.0 : k > 0 ? 2.0 * scaled_pow2(k - 1) : 0.5 * scaled_pow2(k + 1);
+}
+
+class scaled_double {
+	public:
+		double m;   // Mantissa
+		int64_t e;  // Exponent of two
+		scaled_double() : m(0), e(0) { };
+		scaled_double(double x) : m(x), e(0) { renormalize(); };
+		scaled_double(double x, int64_t ex) : m(x), e(ex) { };
+		/* Mantissa in [0.5, 1), or zero, infinite or NaN with exponent 0 */
+		void renormalize()
+		{
+			int k;
+			if (m == 0 || !std::isfinite(m)) {
+				e = 0;
+				return;
+			}
+			m = std::frexp(m, &k);
+			e += k;
+		}
+		scaled_double& operator*=(const scaled_double &b)
+		{
+			double a = std::fabs(m *= b.m);
+			e += b.e;
+			if (a < low_ || a > high_) {
+				renormalize();
+			}
+			return *this;
+		}
+		scaled_double& operator+=(const scaled_double &b)
+		{
+			if (b.m == 0) {
+				return *this;
+			}
+			/* Shifts are clamped so they fit an int; ldexp is 0 long before */
+			if (m == 0 || b.e > e) {
+				m = b.m + std::ldexp(m, (int) std::max<int64_t>(e - b.e, -4096));
+				e = b.e;
+			} else {
+				m += std::ldexp(b.m, (int) std::max<int64_t>(b.e - e, -4096));
+			}
+			renormalize();
+			return *this;
+		}
+	private:
+		static constexpr double low_ = scaled_pow2(-SCALED_RANGE);
+		static constexpr double high_ = scaled_pow2(SCALED_RANGE);
+};
+
+inline scaled_double operator*(scaled_double a, const scaled_double &b)
+{
+	return a *= b;
+}
+
+inline scaled_double operator+(scaled_double a, const scaled_double &b)
+{
+	return a += b;
+}
+
+/* random_reduction_tree marks unevaluated nodes with NaN */
+inline bool isnan(const scaled_double &a)
+{
+	return std::isnan(a.m);
+}
+
+/* Left-associative product of a[0..n) */
+scaled_double scaled_left_prod(const double *a, long long n);
+
+/* The product of a[0..n) correctly rounded */
+scaled_double scaled_exact_prod(const double *a, long long n);
+
+/* |x - exact| / |exact|, 0 if both are the same zero, infinite if only
+ * exact is zero, NaN if either is */
+double scaled_rel_error(const scaled_double &x, const scaled_double &exact);
+
+/* x as %a would print it with a 64-bit exponent, e.g. 0x1.8p-2885000 */
+std::string scaled_hex(const scaled_double &x);
+/* x in decimal to 12 significant digits, e.g. 1.234567890123e-868489 */
+std::string scaled_dec(const scaled_double &x);
+
+#endif
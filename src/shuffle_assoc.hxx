@@ -0,0 +1,116 @@
+/* A random shuffle summed left-associatively and in a random association,
+ * in one pass over the data and without permuting it in place.
+ *
+ * std::random_shuffle writes to random places across the whole vector, and
+ * random_reduction_tree allocates a node per leaf and inner node. Instead:
+ * - every element draws one of B buckets of about SHUFFLE_BUCKET elements,
+ *   which fit in cache, and is copied there, so the copy streams to B places
+ *   rather than n. The draws are made twice from a saved generator, once to
+ *   size the buckets and once to fill them, instead of storing n of them.
+ * - as each bucket is reached it is shuffled with Fisher-Yates, in cache.
+ *   Uniform buckets, then uniform shuffles of each, concatenated, give a
+ *   uniform permutation.
+ * - the random tree is a shape of tree_shape.hxx, evaluated with a stack.
+ *   Its leaves are taken in order, so the shuffled elements are pulled one
+ *   at a time and the left-associative sum takes them too.
+ * The shuffle draws from its own generator, seeded by the caller, so the
+ * rand() stream is left to the tree shapes.
+ */
+#ifndef SHUFFLE_ASSOC_HXX
+#define SHUFFLE_ASSOC_HXX
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "rand.hxx"
+#include "tree_shape.hxx"
+
+/* Elements per bucket, 256 KiB of doubles */
+#define SHUFFLE_BUCKET (1 << 15)
+
+template <typename FLOAT_T>
+struct shuffle_sums {
+	FLOAT_T left;      // Left-associative
+	FLOAT_T tree;      // Randomly associated
+	long long height;  // Of the random tree; NaN tree and -1 if it was too big to draw
+};
+
+/* The shuffled elements, one at a time */
+template <typename FLOAT_T>
+class shuffle_stream {
+	public:
+		shuffle_stream(const FLOAT_T *A, long long n, rand_state_t seed, std::vector<FLOAT_T> &scratch)
+			: n_(n), next_(0), end_(0), bucket_(0), s_(seed)
+		{
+			long long i, b, nb = (n + SHUFFLE_BUCKET - 1) / SHUFFLE_BUCKET;
+			rand_state_t saved = s_;
+			std::vector<long long> fill;
+			start_.assign(nb + 1, 0);
+			for (i = 0; i < n; i++) {
+				start_[draw(nb) + 1]++;
+			}
+			for (b = 0; b < nb; b++) {
+				start_[b + 1] += start_[b];
+			}
+			fill.assign(start_.begin(), start_.end() - 1);
+			s_ = saved;
+			scratch.resize(n);
+			for (i = 0; i < n; i++) {
+				scratch[fill[draw(nb)]++] = A[i];
+			}
+			buf_ = scratch.data();
+		}
+		FLOAT_T next()
+		{
+			long long i, j;
+			while (next_ == end_) {
+				next_ = start_[bucket_];
+				end_ = start_[bucket_ + 1];
+				bucket_++;
+				for (i = end_ - 1; i > next_; i--) {
+					j = next_ + draw(i - next_ + 1);
+					std::swap(buf_[i], buf_[j]);
+				}
+			}
+			return buf_[next_++];
+		}
+	private:
+		/* Uniform in [0, k) */
+		long long draw(long long k)
+		{
+			return std::min((long long) (unif_rand_R_r(&s_) * k), k - 1);
+		}
+		long long n_, next_, end_, bucket_;
+		std::vector<long long> start_;  // Of each bucket in buf_, and the end
+		FLOAT_T *buf_;
+		rand_state_t s_;
+};
+
+/* Shuffle A with the generator seeded by seed and reduce it both ways, the
+ * random association in shape, which has n leaves */
+template <typename FLOAT_T>
+shuffle_sums<FLOAT_T> shuffle_associate(const FLOAT_T *A, long long n, bool is_sum,
+                                        const tree_shape_t &shape, rand_state_t seed,
+                                        std::vector<FLOAT_T> &scratch)
+{
+	shuffle_sums<FLOAT_T> r;
+	shuffle_stream<FLOAT_T> in(A, n, seed, scratch);
+	FLOAT_T x;
+	long long i;
+
+	r.left = is_sum ? 0. : 1.;
+	r.tree = shape_eval<FLOAT_T>(shape, [&]() {
+		x = in.next();
+		r.left = is_sum ? r.left + x : r.left * x;
+		return x;
+	}, is_sum, &r.height);
+	/* Without a tree the shuffle is still summed */
+	for (i = shape.bits == NULL ? 0 : n; i < n; i++) {
+		x = in.next();
+		r.left = is_sum ? r.left + x : r.left * x;
+	}
+	return r;
+}
+
+#endif
@@ -14,11 +14,34 @@ FLOPS = 3000000000f
 LOG_LEVEL = --log=root.thres:critical
 
 VECLEN = 14400
+# reduce_bench sweep: element counts, timed and warm-up repetitions
+BENCH_MIN = 1
+BENCH_MAX = 65536
+BENCH_REPS = 100
+BENCH_WARMUP = 10
+# Job file for batch, see dotprod_mpi -f
+JOBS = dotprod.jobs
+# Jobs and platforms for hier, the reductions along the topology
+HIER_JOBS = hier.jobs
+TOPOLOGY_HIER = fattree-72 torus-2-4-9 dragonfly-3-3-4-2
 TOPO_DIR = ../topologies
+# Read by topo_reduce for the levels of the hierarchical reductions
+export TOPO_DIR
 MPI_REDUCE_ALGOS = default ompi mpich mvapich2 impi automatic \
 	arrival_pattern_aware binomial flat_tree NTSL scatter_gather ompi_chain \
 	ompi_pipeline ompi_binary ompi_in_order_binary ompi_binomial \
 	ompi_basic_linear mvapich2_knomial mvapich2_two_level rab
+# As in nekbone/run-nek.sh
+MPI_ALLREDUCE_ALGOS = default ompi mpich mvapich2 impi rab1 rab2 rab_rsag rdb \
+	smp_binomial smp_binomial_pipeline smp_rdb smp_rsag smp_rsag_lr smp_rsag_rab \
+	redbcast ompi_ring_segmented mvapich2_rs mvapich2_two_level rab
+# Jobs for allreduce, the bitwise agreement of ranks after MPI_Allreduce
+ALLREDUCE_JOBS = allreduce.jobs
+# Jobs for bench, and the rows they gave without the time column. The
+# algorithms are fixed, so the bits only change with the code or SimGrid.
+BENCH_JOBS = bench.jobs
+BENCH_GOLDEN = bench-mpi.golden
+BENCH_ALGO = ompi
 TOPOLOGY_72 = fattree-72 torus-2-4-9
 
 quick :
@@ -27,7 +50,7 @@ quick :
 	smpirun -hostfile $(TOPO_DIR)/hostfile-torus-2-4-9.txt -platform $(TOPO_DIR)/torus-2-4-9.xml -np 72 --cfg=smpi/host-speed:$(FLOPS) --cfg=smpi/reduce:ompi ./dotprod_mpi $(VECLEN) runif[-1,1]  torus-2-4-9 auto
 	smpirun -hostfile $(TOPO_DIR)/hostfile-torus-2-2-4.txt -platform $(TOPO_DIR)/torus-2-2-4.xml -np 4 --cfg=smpi/host-speed:$(FLOPS) --cfg=smpi/reduce:ompi ./dotprod_mpi $(VECLEN) runif[-1,1] torus-2-2-4 auto
 
-.PHONY : quick sim
+.PHONY : quick sim batch timing hier allreduce bench bench_golden
 sim :
 	$(foreach algo,$(MPI_REDUCE_ALGOS), \
 		$(foreach topo,$(TOPOLOGY_16), \
@@ -48,6 +71,94 @@ sim :
 		) \
 	)
 
+# One launch per algorithm and topology, running every job in $(JOBS)
+batch :
+	mkdir -p $(EXP_DIR)
+	$(foreach algo,$(MPI_REDUCE_ALGOS), \
+		$(foreach topo,$(TOPOLOGY_72), \
+			smpirun -hostfile $(TOPO_DIR)/hostfile-$(topo).txt -platform $(TOPO_DIR)/$(topo).xml \
+				-np 72 \
+				--cfg=smpi/host-speed:$(FLOPS) \
+				--cfg=smpi/reduce:$(algo) \
+				$(LOG_LEVEL) \
+				./dotprod_mpi -f $(JOBS) $(topo) $(algo) > $(EXP_DIR)/dotprod-$(topo)-$(algo).tsv; \
+		) \
+	)
+
+# Timing distributions of every reduction in reduce_bench
+timing :
+	mkdir -p $(EXP_DIR)
+	$(foreach algo,$(MPI_REDUCE_ALGOS), \
+		$(foreach topo,$(TOPOLOGY_72), \
+			smpirun -hostfile $(TOPO_DIR)/hostfile-$(topo).txt -platform $(TOPO_DIR)/$(topo).xml \
+				-np 72 \
+				--cfg=smpi/host-speed:$(FLOPS) \
+				--cfg=smpi/reduce:$(algo) \
+				$(LOG_LEVEL) \
+				./reduce_bench $(BENCH_MIN) $(BENCH_MAX) $(BENCH_REPS) $(BENCH_WARMUP) runif[-1,1] $(topo) $(algo) \
+				> $(EXP_DIR)/reduce-bench-$(topo)-$(algo).tsv; \
+		) \
+	)
+
+# Latency and error of reducing along each topology against every flat
+# algorithm: dotprod_mpi for the error, reduce_bench for the timing
+hier :
+	mkdir -p $(EXP_DIR)
+	$(foreach algo,$(MPI_REDUCE_ALGOS), \
+		$(foreach topo,$(TOPOLOGY_HIER), \
+			smpirun -hostfile $(TOPO_DIR)/hostfile-$(topo).txt -platform $(TOPO_DIR)/$(topo).xml \
+				-np 72 \
+				--cfg=smpi/host-speed:$(FLOPS) \
+				--cfg=smpi/reduce:$(algo) \
+				$(LOG_LEVEL) \
+				./dotprod_mpi -f $(HIER_JOBS) $(topo) $(algo) > $(EXP_DIR)/hier-$(topo)-$(algo).tsv; \
+			smpirun -hostfile $(TOPO_DIR)/hostfile-$(topo).txt -platform $(TOPO_DIR)/$(topo).xml \
+				-np 72 \
+				--cfg=smpi/host-speed:$(FLOPS) \
+				--cfg=smpi/reduce:$(algo) \
+				$(LOG_LEVEL) \
+				./reduce_bench $(BENCH_MIN) $(BENCH_MAX) $(BENCH_REPS) $(BENCH_WARMUP) runif[-1,1] $(topo) $(algo) \
+				> $(EXP_DIR)/hier-bench-$(topo)-$(algo).tsv; \
+		) \
+	)
+
+# Whether every rank holds the same bits after each allreduce algorithm
+allreduce :
+	mkdir -p $(EXP_DIR)
+	$(foreach algo,$(MPI_ALLREDUCE_ALGOS), \
+		$(foreach topo,$(TOPOLOGY_72), \
+			smpirun -hostfile $(TOPO_DIR)/hostfile-$(topo).txt -platform $(TOPO_DIR)/$(topo).xml \
+				-np 72 \
+				--cfg=smpi/host-speed:$(FLOPS) \
+				--cfg=smpi/allreduce:$(algo) \
+				$(LOG_LEVEL) \
+				./dotprod_mpi -f $(ALLREDUCE_JOBS) $(topo) $(algo) > $(EXP_DIR)/allreduce-$(topo)-$(algo).tsv; \
+		) \
+	)
+
+# The bits of every reduction of dotprod_mpi on the 16-rank fat tree, which
+# must match $(BENCH_GOLDEN). The simulated time depends on how fast this
+# machine ran the computation, so only the results are compared.
+BENCH_RUN = smpirun -hostfile $(TOPO_DIR)/hostfile-fattree-16.txt -platform $(TOPO_DIR)/fattree-16.xml \
+	-np 16 \
+	--cfg=smpi/host-speed:$(FLOPS) \
+	--cfg=smpi/reduce:$(BENCH_ALGO) \
+	--cfg=smpi/allreduce:$(BENCH_ALGO) \
+	$(LOG_LEVEL) \
+	./dotprod_mpi -f $(BENCH_JOBS) fattree-16 $(BENCH_ALGO) | cut -f1-7,9-
+
+bench :
+ifneq ($(wildcard $(BENCH_GOLDEN)),)
+	$(BENCH_RUN) > bench-mpi.out
+	diff $(BENCH_GOLDEN) bench-mpi.out
+else
+	@echo "Warning: no $(BENCH_GOLDEN), not checking dotprod_mpi under SMPI. make bench_baseline"\
+		"writes it from a build whose results you trust, under the SimGrid that will check it"
+endif
+
+bench_golden :
+	$(BENCH_RUN) > $(BENCH_GOLDEN)
+
 # Potential bug in SimGrid
 differ :
 	smpirun -hostfile $(TOPO_DIR)/hostfile-torus-2-4-9.txt -platform $(TOPO_DIR)/torus-2-4-9.xml -np 72 --cfg=smpi/host-speed:3000000000f --cfg=smpi/reduce:mvapich2_knomial --log=root.thres:critical ./dotprod_mpi 720 torus-2-4-9 mvapich2_knomial
@@ -0,0 +1,242 @@
+/* How much subnormals cost, and what flushing them costs in accuracy.
+ * Each kernel runs with subnormals handled by the hardware and then with
+ * FTZ and DAZ on (subnormal.hxx). For both it reports the operations that
+ * consumed or produced subnormals, the best time over <reps> runs per
+ * operation, and the error against MPFR. "flush change" is how far the
+ * flushed result moved from the unflushed one.
+ *
+ * The kernels are the ones the other programs reduce with: the left-
+ * associative sum, the random tree of random_reduction_tree (as in
+ * assoc_test) and the left-associative dot product of dotprod_mpi and
+ * hybrid.cxx. The MPI reductions are in dotprod_mpi's subnormal variant.
+ *
+ * It also checks running_dot's bound (running_error.hxx) against the error
+ * of the dot product, on the vectors and on them scaled down so that every
+ * product underflows, and exits 1 if either error is above its bound.
+ */
+#ifndef SUBN_BENCH_CXX
+#define SUBN_BENCH_CXX
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <boost/multiprecision/mpfr.hpp>
+
+#include "assoc.hxx"
+#include "rand.hxx"
+#include "running_error.hxx"
+#include "subnormal.hxx"
+#include "vec_map.hxx"
+
+#define USAGE ("subn_bench <n> <reps> <distr> where\n"\
+               "<n> is the length of the vectors\n"\
+               "<reps> is the number of timed runs of each kernel, the best is kept\n"\
+               "<distr> is the distribution to use. Choices are:\n"\
+               "\trunif[0,1] runif[-1,1] runif[-1000,1000] rsubn\n"\
+               "\tf64:<a file>[,<b file>] f32:<a file>[,<b file>] for the first <n>\n"\
+               "\telements of binary files (vec_map.hxx), or all of them if <n> is 0;\n"\
+               "\tb is all ones without one\n")
+
+using namespace boost::multiprecision;
+
+typedef enum subn_kernel {
+	KERNEL_LEFT_SUM,
+	KERNEL_TREE_SUM,
+	KERNEL_LEFT_DOT
+} subn_kernel_t;
+
+static const char *kernel_names[] = {"Left assoc", "Random assoc", "Left assoc dot"};
+
+static double now()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* One run of kernel k, with only the reduction itself timed */
+static double run_kernel(subn_kernel_t k, const double *a, const double *b, long long n, double *time)
+{
+	double t, acc = 0.0;
+	if (k == KERNEL_TREE_SUM) {
+		/* The same tree every time; the tree only reads its leaves */
+		srand(ASSOC_SEED);
+		random_reduction_tree<double> tr(2, (long) n, const_cast<double *>(a));
+		t = now();
+		acc = tr.sum_tree();
+		*time = now() - t;
+		return acc;
+	}
+	t = now();
+	if (k == KERNEL_LEFT_SUM) {
+		for (long long i = 0; i < n; i++) {
+			acc = acc + a[i];
+		}
+	} else {
+		for (long long i = 0; i < n; i++) {
+			acc = acc + a[i] * b[i];
+		}
+	}
+	*time = now() - t;
+	return acc;
+}
+
+/* 0 if the running bound of a . b, each scaled by 2^scale, holds */
+static int check_running(const double *a, const double *b, long long n, int scale)
+{
+	std::vector<double> as(n), bs(n);
+	mpfr_float_1000 exact = 0.0;
+	running_error<double> run;
+	double err;
+	for (long long i = 0; i < n; i++) {
+		as[i] = std::ldexp(a[i], scale);
+		bs[i] = std::ldexp(b[i], scale);
+		exact += mpfr_float_1000(as[i]) * bs[i];
+	}
+	run = running_dot(as.data(), bs.data(), n);
+	err = abs(run.val - exact).convert_to<double>();
+	fprintf(stderr, "running_dot scaled by 2^%d: error %a, bound %a\n", scale, err, run.err);
+	if (abs(run.val - exact) > run.err) {
+		fprintf(stderr, "running_dot's bound is below its error\n");
+		return 1;
+	}
+	return 0;
+}
+
+/* The same operations on subnormal_counted */
+static subn_count_t count_kernel(subn_kernel_t k, const double *a, const double *b, long long n)
+{
+	subnormal_counted<double> acc;
+	std::vector<subnormal_counted<double> > leaves;
+	if (k == KERNEL_LEFT_DOT) {
+		return subnormal_dot_count(a, b, n);
+	}
+	subnormal_counted<double>::reset();
+	if (k == KERNEL_LEFT_SUM) {
+		for (long long i = 0; i < n; i++) {
+			acc += subnormal_counted<double>(a[i]);
+		}
+	} else {
+		leaves.assign(a, a + n);
+		srand(ASSOC_SEED);
+		random_reduction_tree<subnormal_counted<double> > tr(2, (long) n, leaves.data());
+		tr.sum_tree();
+	}
+	return subnormal_counted<double>::counts;
+}
+
+int main (int argc, char* argv[])
+{
+	long long len, i, reps, r;
+	int k, f, flushes;
+	double (*rand_flt)(); // Function to generate a random float
+	double mag, res, t, best, err, res_off[3];
+	bool was;
+	vec_kind_t kind;
+	vec_map_t map_a, map_b;
+	std::string path_a, path_b, msg;
+	std::vector<double> abuf, bbuf;
+	const double *a, *b;
+	mpfr_float_1000 exact[3];
+	subn_count_t c;
+
+	if (argc != 4) {
+		fprintf(stderr, USAGE);
+		return 1;
+	}
+	len = atoll(argv[1]);
+	reps = atoll(argv[2]);
+	std::string dist = argv[3];
+	bool from_file = parse_vec_files(dist, &kind, &path_a, &path_b) == 0;
+	if (len < 0 || (len == 0 && !from_file) || reps <= 0) {
+		fprintf(stderr, USAGE);
+		return 1;
+	}
+	if (!from_file && parse_distr<double>(dist, &mag, &rand_flt) != 0) {
+		fprintf(stderr, "Unrecognized distribution:\n%s", USAGE);
+		return 1;
+	}
+
+	map_a.base = map_b.base = NULL;
+	if (from_file) {
+		if (vec_map_open(path_a, kind, &map_a, msg) != 0
+				|| (!path_b.empty() && vec_map_open(path_b, kind, &map_b, msg) != 0)) {
+			fprintf(stderr, "%s\n", msg.c_str());
+			return 1;
+		}
+		if (len == 0) {
+			len = map_a.n;
+		}
+		if (len > map_a.n || (!path_b.empty() && len > map_b.n)) {
+			fprintf(stderr, "%s has fewer than %lld elements\n", dist.c_str(), len);
+			return 1;
+		}
+		abuf.resize(kind == VEC_F32 ? len : 0);
+		a = vec_map_doubles(map_a, 0, len, abuf.data());
+		if (path_b.empty()) {
+			bbuf.assign(len, 1.0);
+			b = bbuf.data();
+		} else {
+			bbuf.resize(kind == VEC_F32 ? len : 0);
+			b = vec_map_doubles(map_b, 0, len, bbuf.data());
+		}
+	} else {
+		/* Interleaved like dotprod_mpi, so a and b differ */
+		set_seed(ASSOC_SEED, 0);
+		abuf.resize(len);
+		bbuf.resize(len);
+		for (i = 0; i < len; i++) {
+			abuf[i] = rand_flt();
+			bbuf[i] = rand_flt();
+		}
+		a = abuf.data();
+		b = bbuf.data();
+	}
+
+	/* Products are exact in MPFR, unlike in mpfr_dot */
+	exact[KERNEL_LEFT_SUM] = 0.0;
+	exact[KERNEL_LEFT_DOT] = 0.0;
+	for (i = 0; i < len; i++) {
+		exact[KERNEL_LEFT_SUM] += mpfr_float_1000(a[i]);
+		exact[KERNEL_LEFT_DOT] += mpfr_float_1000(a[i]) * b[i];
+	}
+	exact[KERNEL_TREE_SUM] = exact[KERNEL_LEFT_SUM];
+
+	flushes = fp_flush_supported() ? 2 : 1;
+	if (flushes == 1) {
+		fprintf(stderr, "Cannot flush subnormals on this machine, timing without only\n");
+	}
+	printf("veclen\tdistribution\tkernel\tflush\tops\tsubnormal in\tsubnormal out\t"
+	       "ns per op\tFP (decimal)\tFP (%%a)\terror\tflush change\n");
+	for (k = KERNEL_LEFT_SUM; k <= KERNEL_LEFT_DOT; k++) {
+		for (f = 0; f < flushes; f++) {
+			was = fp_flush(f == 1);
+			c = count_kernel((subn_kernel_t) k, a, b, len);
+			best = INFINITY;
+			res = 0.0;
+			for (r = 0; r < reps; r++) {
+				res = run_kernel((subn_kernel_t) k, a, b, len, &t);
+				best = std::min(best, t);
+			}
+			fp_flush(was);
+			if (f == 0) {
+				res_off[k] = res;
+			}
+			err = abs(res - exact[k]).convert_to<double>();
+			printf("%lld\t%s\t%s\t%s\t%lld\t%lld\t%lld\t%.3f\t%.15e\t%a\t%e\t%e\n",
+				len, dist.c_str(), kernel_names[k], f == 1 ? "FTZ+DAZ" : "off",
+				c.ops, c.consumed, c.produced, best * 1e9 / std::max(c.ops, 1LL),
+				res, res, err, fabs(res - res_off[k]));
+			fflush(stdout);
+		}
+	}
+	/* Products of the scaled vectors are below 2^-1022 */
+	k = check_running(a, b, len, 0) | check_running(a, b, len, -540);
+	vec_map_close(&map_a);
+	vec_map_close(&map_b);
+	return k;
+}
+
+#endif
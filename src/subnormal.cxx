@@ -0,0 +1,52 @@
+/* Flushing subnormals to zero. See subnormal.hxx */
+#include "subnormal.hxx"
+
+#if defined(__x86_64__) || defined(__SSE2__)
+#include <xmmintrin.h>
+
+/* MXCSR flush to zero and denormals are zero */
+#define FLUSH_BITS (0x8000U | 0x0040U)
+
+int fp_flush_supported()
+{
+	return 1;
+}
+
+bool fp_flush(bool on)
+{
+	unsigned int csr = _mm_getcsr();
+	_mm_setcsr(on ? csr | FLUSH_BITS : csr & ~FLUSH_BITS);
+	return (csr & FLUSH_BITS) == FLUSH_BITS;
+}
+
+#elif defined(__aarch64__)
+
+/* FPCR.FZ flushes both inputs and results */
+#define FLUSH_BITS (1ULL << 24)
+
+int fp_flush_supported()
+{
+	return 1;
+}
+
+bool fp_flush(bool on)
+{
+	uint64_t fpcr;
+	__asm__ __volatile__("mrs %0, fpcr" : "=r" (fpcr));
+	__asm__ __volatile__("msr fpcr, %0" : : "r" (on ? fpcr | FLUSH_BITS : fpcr & ~FLUSH_BITS));
+	return (fpcr & FLUSH_BITS) != 0;
+}
+
+#else
+
+int fp_flush_supported()
+{
+	return 0;
+}
+
+bool fp_flush(bool on)
+{
+	return false;
+}
+
+#endif
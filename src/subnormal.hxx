@@ -0,0 +1,123 @@
+/* Subnormal numbers in reductions: counting the operations that touch them,
+ * and flushing them to zero.
+ *
+ * An addition or multiplication with a subnormal operand or result takes a
+ * microcode assist on most x86 cores, tens to hundreds of cycles instead of
+ * a few, which is the slowdown rsubn is there to provoke (notes.md). The
+ * hardware can instead flush them: FTZ makes subnormal results zero and DAZ
+ * reads subnormal operands as zero, trading the slowdown for error.
+ * - fp_flush turns both on or off for the calling thread: MXCSR on x86-64
+ *   (SSE and AVX arithmetic, not x87), FPCR.FZ on AArch64, which does both.
+ *   The mode belongs to the thread, so it does not reach OpenMP threads
+ *   that already exist, nor progress threads of the MPI library.
+ * - subnormal_counted<FLOAT_T> counts each + and * in subnormal_counts, and
+ *   whether an operand (consumed) or the result (produced) was subnormal.
+ *   Like running_error it has what random_reduction_tree needs.
+ * Classification is by the bits, so under DAZ an operand the hardware reads
+ * as zero still counts as consumed.
+ */
+#ifndef SUBNORMAL_HXX
+#define SUBNORMAL_HXX
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+typedef struct subn_count {
+	long long ops;
+	long long consumed;  // Operations with a subnormal operand
+	long long produced;  // Operations with a subnormal result
+} subn_count_t;
+
+/* 1 if fp_flush does anything on this machine, else 0 */
+int fp_flush_supported();
+/* Flush subnormals to zero in this thread, or stop. Returns whether it
+ * was flushing before, to restore it. */
+bool fp_flush(bool on);
+
+inline bool is_subnormal(double x)
+{
+	uint64_t u;
+	memcpy(&u, &x, sizeof(u));
+	return (u & 0x7ff0000000000000ULL) == 0 && (u & 0x000fffffffffffffULL) != 0;
+}
+
+inline bool is_subnormal(float x)
+{
+	uint32_t u;
+	memcpy(&u, &x, sizeof(u));
+	return (u & 0x7f800000U) == 0 && (u & 0x007fffffU) != 0;
+}
+
+inline void subn_count_op(subn_count_t &c, bool consumed, bool produced)
+{
+	c.ops++;
+	c.consumed += consumed;
+	c.produced += produced;
+}
+
+template <typename FLOAT_T>
+class subnormal_counted {
+	public:
+		FLOAT_T val;
+		subnormal_counted() : val(0) { };
+		subnormal_counted(FLOAT_T x) : val(x) { };
+		subnormal_counted& operator+=(const subnormal_counted &b)
+		{
+			FLOAT_T s = val + b.val;
+			subn_count_op(counts, is_subnormal(val) || is_subnormal(b.val), is_subnormal(s));
+			val = s;
+			return *this;
+		}
+		subnormal_counted& operator*=(const subnormal_counted &b)
+		{
+			FLOAT_T p = val * b.val;
+			subn_count_op(counts, is_subnormal(val) || is_subnormal(b.val), is_subnormal(p));
+			val = p;
+			return *this;
+		}
+		/* Of every subnormal_counted<FLOAT_T> since the last reset */
+		static subn_count_t counts;
+		static void reset() { counts = subn_count_t{0, 0, 0}; };
+};
+
+template <typename FLOAT_T>
+subn_count_t subnormal_counted<FLOAT_T>::counts = {0, 0, 0};
+
+template <typename FLOAT_T>
+subnormal_counted<FLOAT_T> operator+(subnormal_counted<FLOAT_T> a, const subnormal_counted<FLOAT_T> &b)
+{
+	return a += b;
+}
+
+template <typename FLOAT_T>
+subnormal_counted<FLOAT_T> operator*(subnormal_counted<FLOAT_T> a, const subnormal_counted<FLOAT_T> &b)
+{
+	return a *= b;
+}
+
+/* random_reduction_tree marks unevaluated nodes with NaN */
+template <typename FLOAT_T>
+bool isnan(const subnormal_counted<FLOAT_T> &a)
+{
+	return std::isnan(a.val);
+}
+
+/* Counts of the left-associative dot product, as dot() computes it */
+template <typename FLOAT_T>
+subn_count_t subnormal_dot_count(const FLOAT_T *a, const FLOAT_T *b, long long n)
+{
+	subnormal_counted<FLOAT_T> acc;
+	subn_count_t before = subnormal_counted<FLOAT_T>::counts, c;
+	for (long long i = 0; i < n; i++) {
+		acc += subnormal_counted<FLOAT_T>(a[i]) * subnormal_counted<FLOAT_T>(b[i]);
+	}
+	c = subnormal_counted<FLOAT_T>::counts;
+	subnormal_counted<FLOAT_T>::counts = before;
+	c.ops -= before.ops;
+	c.consumed -= before.consumed;
+	c.produced -= before.produced;
+	return c;
+}
+
+#endif
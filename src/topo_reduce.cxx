@@ -0,0 +1,350 @@
+/* Hierarchical reductions along the platform topology. See topo_reduce.hxx */
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+#include "topo_reduce.hxx"
+
+#define TOPO_TAG 4321
+
+std::string topo_dir()
+{
+	const char *dir = getenv("TOPO_DIR");
+	return dir != NULL && dir[0] != '\0' ? dir : TOPO_DIR_DEFAULT;
+}
+
+int parse_level_tree(std::string description, level_tree_t *how)
+{
+	if (description == "linear") {
+		*how = LEVEL_LINEAR;
+	} else if (description == "binomial") {
+		*how = LEVEL_BINOMIAL;
+	} else {
+		return 1;
+	}
+	return 0;
+}
+
+/* Value of attribute name in the first <cluster> element of xml */
+static int cluster_attr(const std::string &xml, const std::string &name, std::string &value)
+{
+	size_t start = xml.find("<cluster"), end, p;
+	if (start == std::string::npos) {
+		return 1;
+	}
+	end = xml.find('>', start);
+	for (p = xml.find(name + "=\"", start); p != std::string::npos && p < end;
+			p = xml.find(name + "=\"", p + 1)) {
+		/* Not the tail of a longer attribute name */
+		if (!isspace((unsigned char) xml[p - 1])) {
+			continue;
+		}
+		p += name.size() + 2;
+		value = xml.substr(p, xml.find('"', p) - p);
+		return 0;
+	}
+	return 1;
+}
+
+/* Integers of s, with any of the characters in sep between them */
+static std::vector<long long> split_ints(const std::string &s, const char *sep)
+{
+	std::vector<long long> v;
+	size_t p = 0, q;
+	while (p <= s.size()) {
+		q = s.find_first_of(sep, p);
+		if (q == std::string::npos) {
+			q = s.size();
+		}
+		v.push_back(atoll(s.substr(p, q - p).c_str()));
+		p = q + 1;
+	}
+	return v;
+}
+
+/* Group sizes in hosts, innermost first, from the cluster's topology */
+static int topo_spans(const std::string &kind, const std::string &params,
+                      std::vector<long long> &span, std::vector<std::string> &name,
+                      std::string &msg)
+{
+	std::vector<long long> v;
+	long long s = 1;
+	size_t i;
+	if (kind == "FAT_TREE") {
+		/* L;m1,...,mL;w1,...,wL;p1,...,pL */
+		v = split_ints(params, ";,");
+		if (v.empty() || v[0] <= 0 || (long long) v.size() < 1 + v[0]) {
+			msg = "Bad FAT_TREE topo_parameters " + params;
+			return 1;
+		}
+		for (i = 1; i <= (size_t) v[0]; i++) {
+			s *= v[i];
+			span.push_back(s);
+			name.push_back("switch-" + std::to_string(i));
+		}
+	} else if (kind == "TORUS") {
+		v = split_ints(params, ",");
+		for (i = 0; i < v.size(); i++) {
+			s *= v[i];
+			span.push_back(s);
+			name.push_back("dim-" + std::to_string(i));
+		}
+	} else if (kind == "DRAGONFLY") {
+		/* groups,links;chassis,links;routers,links;nodes */
+		v = split_ints(params, ";,");
+		if (v.size() != 7) {
+			msg = "Bad DRAGONFLY topo_parameters " + params;
+			return 1;
+		}
+		const char *names[] = {"router", "chassis", "group", "global"};
+		const long long counts[] = {v[6], v[4], v[2], v[0]};
+		for (i = 0; i < 4; i++) {
+			s *= counts[i];
+			span.push_back(s);
+			name.push_back(names[i]);
+		}
+	} else {
+		msg = "Unsupported topology " + kind;
+		return 1;
+	}
+	for (i = 0; i < span.size(); i++) {
+		if (span[i] <= 0) {
+			msg = "Bad topo_parameters " + params;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Radical of host, or -1 if it is not prefix<n>suffix */
+static long long host_index(const std::string &host, const std::string &prefix,
+                            const std::string &suffix)
+{
+	std::string mid;
+	if (host.size() <= prefix.size() + suffix.size()
+			|| host.compare(0, prefix.size(), prefix) != 0
+			|| host.compare(host.size() - suffix.size(), suffix.size(), suffix) != 0) {
+		return -1;
+	}
+	mid = host.substr(prefix.size(), host.size() - prefix.size() - suffix.size());
+	if (mid.find_first_not_of("0123456789") != std::string::npos) {
+		return -1;
+	}
+	return atoll(mid.c_str());
+}
+
+static int rank_host(const std::string &hostfile, const std::string &prefix,
+                     const std::string &suffix, long long *host, std::string &msg)
+{
+	char name[MPI_MAX_PROCESSOR_NAME];
+	int len, world_rank;
+	std::vector<std::string> lines;
+	std::string line;
+
+	MPI_Get_processor_name(name, &len);
+	*host = host_index(std::string(name, len), prefix, suffix);
+	if (*host >= 0) {
+		return 0;
+	}
+	std::ifstream in(hostfile);
+	while (std::getline(in, line)) {
+		std::istringstream ss(line);
+		if (ss >> line) {
+			lines.push_back(line);
+		}
+	}
+	if (lines.empty()) {
+		msg = std::string("Host ") + name + " is not in the platform and there is no " + hostfile;
+		return 1;
+	}
+	MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+	*host = host_index(lines[world_rank % lines.size()], prefix, suffix);
+	if (*host < 0) {
+		msg = "Host " + lines[world_rank % lines.size()] + " in " + hostfile + " is not in the platform";
+		return 1;
+	}
+	return 0;
+}
+
+/* Add a level grouping the leaders of the level below by color */
+static void add_level(topo_hier_t *h, MPI_Comm comm, int rank, long long color,
+                      const std::string &name)
+{
+	MPI_Comm below = h->comm.back(), c;
+	int r = -1, n = 1, largest;
+	if (below != MPI_COMM_NULL) {
+		MPI_Comm_rank(below, &r);
+	}
+	MPI_Comm_split(comm, r == 0 ? (int) color : MPI_UNDEFINED, rank, &c);
+	if (c != MPI_COMM_NULL) {
+		MPI_Comm_size(c, &n);
+	}
+	MPI_Allreduce(&n, &largest, 1, MPI_INT, MPI_MAX, comm);
+	/* A level where no group has two members adds nothing */
+	if (largest == 1) {
+		if (c != MPI_COMM_NULL) {
+			MPI_Comm_free(&c);
+		}
+		return;
+	}
+	h->comm.push_back(c);
+	h->name.push_back(name);
+	h->size.push_back(largest);
+}
+
+int topo_hier_create(const std::string &dir, const std::string &topo, MPI_Comm comm,
+                     topo_hier_t *h, std::string &msg)
+{
+	int rank, n, largest, ok, all_ok;
+	long long host = 0;
+	size_t l;
+	std::string kind, params, prefix, suffix;
+	std::vector<long long> span;
+	std::vector<std::string> name;
+	std::ifstream in(dir + "/" + topo + ".xml");
+	std::stringstream xml;
+	MPI_Comm c;
+
+	MPI_Comm_rank(comm, &rank);
+	h->comm.clear();
+	h->name.clear();
+	h->size.clear();
+	if (!in) {
+		/* Shared memory, then everything */
+		MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &c);
+		MPI_Comm_size(c, &n);
+		MPI_Allreduce(&n, &largest, 1, MPI_INT, MPI_MAX, comm);
+		h->comm.push_back(c);
+		h->name.push_back("node");
+		h->size.push_back(largest);
+		add_level(h, comm, rank, 0, "global");
+		return 0;
+	}
+	xml << in.rdbuf();
+	if (cluster_attr(xml.str(), "topology", kind) != 0
+			|| cluster_attr(xml.str(), "topo_parameters", params) != 0) {
+		msg = "No <cluster> with a topology in " + dir + "/" + topo + ".xml";
+		return 1;
+	}
+	cluster_attr(xml.str(), "prefix", prefix);
+	cluster_attr(xml.str(), "suffix", suffix);
+	ok = topo_spans(kind, params, span, name, msg) == 0
+	     && rank_host(dir + "/hostfile-" + topo + ".txt", prefix, suffix, &host, msg) == 0;
+	/* Fail together rather than leave some ranks in MPI_Comm_split */
+	MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, comm);
+	if (!all_ok) {
+		if (ok) {
+			msg = "Another rank could not place itself in " + topo;
+		}
+		return 1;
+	}
+
+	/* Ranks on one host, then the groups of hosts. The outermost span is
+	 * normally the whole platform; if not, finish with a global level. */
+	MPI_Comm_split(comm, (int) host, rank, &c);
+	MPI_Comm_size(c, &n);
+	MPI_Allreduce(&n, &largest, 1, MPI_INT, MPI_MAX, comm);
+	h->comm.push_back(c);
+	h->name.push_back("node");
+	h->size.push_back(largest);
+	for (l = 0; l < span.size(); l++) {
+		add_level(h, comm, rank, host / span[l], name[l]);
+	}
+	add_level(h, comm, rank, 0, "global");
+	return 0;
+}
+
+void topo_hier_free(topo_hier_t *h)
+{
+	for (size_t l = 0; l < h->comm.size(); l++) {
+		if (h->comm[l] != MPI_COMM_NULL) {
+			MPI_Comm_free(&h->comm[l]);
+		}
+	}
+	h->comm.clear();
+	h->name.clear();
+	h->size.clear();
+}
+
+long long topo_height(const topo_hier_t &h, level_tree_t how)
+{
+	long long height = 0;
+	for (size_t l = 0; l < h.size.size(); l++) {
+		height += how == LEVEL_LINEAR ? h.size[l] - 1 : (long long) ceil(log2(h.size[l]));
+	}
+	return height;
+}
+
+/* Sum acc over c into acc on rank 0 of c. Returns whether this rank still
+ * holds a partial, that is, whether it is rank 0. */
+static bool level_reduce(double *acc, double *recv, int count, MPI_Comm c, level_tree_t how)
+{
+	int r, p, i, mask, src;
+	MPI_Comm_rank(c, &r);
+	MPI_Comm_size(c, &p);
+	if (how == LEVEL_LINEAR) {
+		if (r != 0) {
+			MPI_Send(acc, count, MPI_DOUBLE, 0, TOPO_TAG, c);
+			return false;
+		}
+		for (src = 1; src < p; src++) {
+			MPI_Recv(recv, count, MPI_DOUBLE, src, TOPO_TAG, c, MPI_STATUS_IGNORE);
+			for (i = 0; i < count; i++) {
+				acc[i] = acc[i] + recv[i];
+			}
+		}
+		return true;
+	}
+	for (mask = 1; mask < p; mask <<= 1) {
+		if (r & mask) {
+			MPI_Send(acc, count, MPI_DOUBLE, r - mask, TOPO_TAG, c);
+			return false;
+		}
+		if (r + mask < p) {
+			MPI_Recv(recv, count, MPI_DOUBLE, r + mask, TOPO_TAG, c, MPI_STATUS_IGNORE);
+			for (i = 0; i < count; i++) {
+				acc[i] = acc[i] + recv[i];
+			}
+		}
+	}
+	return true;
+}
+
+/* Partial sums up the levels; returns whether this rank holds the total */
+static bool reduce_up(const double *in, int count, topo_hier_t &h, level_tree_t how)
+{
+	h.acc.assign(in, in + count);
+	h.recv.resize(count);
+	for (size_t l = 0; l < h.comm.size(); l++) {
+		if (h.comm[l] == MPI_COMM_NULL
+				|| !level_reduce(h.acc.data(), h.recv.data(), count, h.comm[l], how)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void topo_reduce(const double *in, double *out, int count, topo_hier_t &h, level_tree_t how)
+{
+	if (reduce_up(in, count, h, how)) {
+		memcpy(out, h.acc.data(), count * sizeof(double));
+	}
+}
+
+void topo_allreduce(const double *in, double *out, int count, topo_hier_t &h, level_tree_t how)
+{
+	reduce_up(in, count, h, how);
+	/* A rank is in a prefix of the levels, and leads all but the last */
+	for (size_t l = h.comm.size(); l-- > 0; ) {
+		if (h.comm[l] != MPI_COMM_NULL) {
+			MPI_Bcast(h.acc.data(), count, MPI_DOUBLE, 0, h.comm[l]);
+		}
+	}
+	memcpy(out, h.acc.data(), count * sizeof(double));
+}
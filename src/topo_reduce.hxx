@@ -0,0 +1,69 @@
+/* Hierarchical reduction that follows the machine instead of the MPI
+ * library's choice of tree. The levels come from the SimGrid platform in
+ * topologies/: ranks on one host, then the groups of hosts the network is
+ * built from, then everything.
+ * - FAT_TREE  "L;m1,...,mL;...": hosts under one level-1 switch (m1), under
+ *             one level-2 switch (m1*m2), ...
+ * - TORUS     "d1,d2,...": a ring along the first dimension (d1), a plane
+ *             (d1*d2), ...
+ * - DRAGONFLY "g,_;c,_;r,_;n": one router (n), chassis (n*r), group
+ *             (n*r*c), all groups
+ * SimGrid numbers hosts so each of these groups is a contiguous range of
+ * the radical. At every level the lowest rank of each group is its leader,
+ * and only leaders take part in the next level up, so the sum of the whole
+ * communicator ends on its rank 0.
+ *
+ * Within a level the leader combines its group with a fixed tree of
+ * point-to-point messages, so the association, and with it the result,
+ * depends only on the topology and the ranks, not on the MPI library.
+ */
+#ifndef TOPO_REDUCE_HXX
+#define TOPO_REDUCE_HXX
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+/* Where the platforms are, relative to src/, unless TOPO_DIR is set */
+#define TOPO_DIR_DEFAULT "../topologies"
+
+typedef enum level_tree {
+	LEVEL_LINEAR,    // The leader adds the others in rank order
+	LEVEL_BINOMIAL   // Rank i adds in rank i + mask for mask = 1, 2, 4, ...
+} level_tree_t;
+
+/* The levels seen by one rank, innermost first. comm[l] is MPI_COMM_NULL
+ * where this rank did not lead its group at level l-1. */
+typedef struct topo_hier {
+	std::vector<MPI_Comm> comm;
+	std::vector<std::string> name;
+	std::vector<int> size;          // Largest group at each level, over all ranks
+	std::vector<double> acc, recv;  // Scratch for topo_reduce
+} topo_hier_t;
+
+/* "linear" or "binomial". 0 on success, 1 on failure. */
+int parse_level_tree(std::string description, level_tree_t *how);
+
+/* $TOPO_DIR, or TOPO_DIR_DEFAULT */
+std::string topo_dir();
+
+/* Levels for the ranks of comm from <dir>/<topo>.xml. A rank's host is the
+ * one MPI_Get_processor_name names if it is in the platform (as under
+ * SMPI), else line (rank in MPI_COMM_WORLD) mod (lines) of
+ * <dir>/hostfile-<topo>.txt. Without the platform file, the levels are
+ * MPI_COMM_TYPE_SHARED and then global. Collective over comm.
+ * 0 on success, 1 with a reason in msg. */
+int topo_hier_create(const std::string &dir, const std::string &topo, MPI_Comm comm,
+                     topo_hier_t *h, std::string &msg);
+void topo_hier_free(topo_hier_t *h);
+
+/* Height of the whole reduction tree */
+long long topo_height(const topo_hier_t &h, level_tree_t how);
+
+/* Elementwise sum of count doubles. topo_reduce leaves it in out on rank 0
+ * of the communicator h was created for; topo_allreduce on every rank,
+ * broadcast back down the levels. */
+void topo_reduce(const double *in, double *out, int count, topo_hier_t &h, level_tree_t how);
+void topo_allreduce(const double *in, double *out, int count, topo_hier_t &h, level_tree_t how);
+
+#endif
@@ -0,0 +1,221 @@
+/* Random tree shapes and their store. See tree_shape.hxx */
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tree_shape.hxx"
+
+#define SHAPE_MAGIC "REDSHAP1"
+
+/* File header, 8-byte fields in the byte order of the machine. The first
+ * rand() after srand(seed) tells whether this rand() drew the shapes. */
+enum {
+	SH_MAGIC = 0, SH_LEAVES = 1, SH_SEED = 2, SH_CHECK = 3, SH_COUNT = 4,
+	SH_WORDS = 8
+};
+
+long long shape_words(long long leaves)
+{
+	return (2 * leaves - 1 + 63) / 64;
+}
+
+void shape_draw(long long leaves, std::vector<uint64_t> &bits)
+{
+	long long N = leaves - 1, x, k, b, n, s, i = 0;
+	std::vector<long long> L(2 * N + 1), stack;
+
+	/* Algorithm R, as in grow_random_binary_tree */
+	L[0] = 0;
+	for (n = 0; n < N; ) {
+		x = rand() % (4 * n + 2);
+		n++;
+		b = x % 2;
+		k = x / 2;
+		L[2*n - b] = 2*n;
+		L[2*n - 1 + b] = L[k];
+		L[k] = 2*n - 1;
+	}
+	/* Even nodes are leaves, odd ones have children L[s] and L[s+1] */
+	bits.assign(shape_words(leaves), 0);
+	stack.push_back(L[0]);
+	while (!stack.empty()) {
+		s = stack.back();
+		stack.pop_back();
+		if (s % 2 == 1) {
+			bits[i / 64] |= 1ULL << (i % 64);
+			stack.push_back(L[s + 1]);
+			stack.push_back(L[s]);
+		}
+		i++;
+	}
+}
+
+/* Too big for the L array of grow_random_binary_tree */
+static bool too_big(long long leaves)
+{
+	return 2 * (leaves - 1) + 1 >= RAND_MAX;
+}
+
+bool shape_valid(const uint64_t *bits, long long leaves)
+{
+	long long i, nodes = 2 * leaves - 1, open = 1, words = shape_words(leaves);
+	for (i = 0; i < nodes; i++) {
+		if (open == 0) {
+			return false;
+		}
+		/* An inner node takes one open place and opens two */
+		open += ((bits[i / 64] >> (i % 64)) & 1) ? 1 : -1;
+	}
+	return open == 0 && (nodes % 64 == 0 || (bits[words - 1] >> (nodes % 64)) == 0);
+}
+
+std::string shape_cache_dir()
+{
+	const char *d = getenv("SHAPE_CACHE");
+	return d == NULL ? "" : d;
+}
+
+void shape_cache_open(const std::string &dir, long long leaves, unsigned int seed,
+                      shape_cache_t *c, std::string &msg)
+{
+	uint64_t h[SH_WORDS], want[SH_WORDS];
+	struct stat st;
+	std::string path;
+	void *p;
+
+	c->leaves = leaves;
+	c->seed = seed;
+	c->fd = -1;
+	c->base = NULL;
+	c->bytes = 0;
+	c->stored = c->next = c->owed = 0;
+	msg = "";
+	memset(want, 0, sizeof(want));
+	memcpy(want, SHAPE_MAGIC, 8);
+	want[SH_LEAVES] = (uint64_t) leaves;
+	want[SH_SEED] = seed;
+	srand(seed);
+	want[SH_CHECK] = (uint64_t) rand();
+	srand(seed);
+	if (dir.empty() || too_big(leaves)) {
+		return;
+	}
+
+	path = dir + "/shapes-" + std::to_string(leaves) + "-" + std::to_string(seed) + ".bin";
+	c->fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (c->fd < 0) {
+		msg = "Could not open " + path + ": " + strerror(errno);
+		return;
+	}
+	/* Runs starting together take turns, so only the first writes the
+	 * header and no one cuts a file another has started to fill */
+	if (flock(c->fd, LOCK_EX) != 0) {
+		msg = "Could not lock " + path + ": " + strerror(errno);
+		close(c->fd);
+		c->fd = -1;
+		return;
+	}
+	if (pread(c->fd, h, sizeof(h), 0) != (ssize_t) sizeof(h)) {
+		/* New, or cut short before its header was whole */
+		want[SH_COUNT] = 0;
+		if (ftruncate(c->fd, 0) != 0 || pwrite(c->fd, want, sizeof(want), 0) != (ssize_t) sizeof(want)) {
+			msg = "Could not write " + path;
+			close(c->fd);
+			c->fd = -1;
+			return;
+		}
+		flock(c->fd, LOCK_UN);
+		return;
+	}
+	flock(c->fd, LOCK_UN);
+	if (memcmp(h, want, SH_COUNT * sizeof(uint64_t)) != 0) {
+		msg = path + " holds other shapes, not using it";
+		close(c->fd);
+		c->fd = -1;
+		return;
+	}
+	/* Only whole shapes, however far another run got */
+	if (fstat(c->fd, &st) == 0) {
+		c->stored = std::min((long long) h[SH_COUNT],
+		                     (long long) ((st.st_size - sizeof(h)) / (shape_words(leaves) * 8)));
+	}
+	if (c->stored <= 0) {
+		c->stored = 0;
+		return;
+	}
+	c->bytes = sizeof(h) + c->stored * shape_words(leaves) * 8;
+	p = mmap(NULL, c->bytes, PROT_READ, MAP_SHARED, c->fd, 0);
+	if (p == MAP_FAILED) {
+		msg = "Could not map " + path + ": " + strerror(errno);
+		c->stored = 0;
+		c->bytes = 0;
+		return;
+	}
+	madvise(p, c->bytes, MADV_SEQUENTIAL);
+	c->base = (const uint64_t *) p + SH_WORDS;
+}
+
+tree_shape_t shape_cache_next(shape_cache_t *c)
+{
+	tree_shape_t s;
+	long long words = shape_words(c->leaves);
+	uint64_t count;
+
+	s.leaves = c->leaves;
+	s.bits = NULL;
+	if (too_big(c->leaves)) {
+		return s;
+	}
+	if (c->next < c->stored && !shape_valid(c->base + c->next * words, c->leaves)) {
+		/* Draw from here on, writing the record again */
+		c->stored = c->next;
+	}
+	if (c->next < c->stored) {
+		/* Drawing it would have called rand() once per inner node */
+		c->owed += c->leaves - 1;
+		s.bits = c->base + c->next * words;
+		c->next++;
+		return s;
+	}
+	for (; c->owed > 0; c->owed--) {
+		rand();
+	}
+	shape_draw(c->leaves, c->drawn);
+	s.bits = c->drawn.data();
+	if (c->fd >= 0 && (SH_WORDS + (c->next + 1) * words) * 8 <= SHAPE_CACHE_MAX) {
+		/* Only raise the count: a run that has drawn fewer must not hide
+		 * the shapes another has written past it */
+		if (flock(c->fd, LOCK_EX) != 0 || pread(c->fd, &count, 8, SH_COUNT * 8) != 8) {
+			close(c->fd);
+			c->fd = -1;
+		} else {
+			count = std::max(count, (uint64_t) c->next + 1);
+			if (pwrite(c->fd, c->drawn.data(), words * 8, (SH_WORDS + c->next * words) * 8) != words * 8
+					|| pwrite(c->fd, &count, 8, SH_COUNT * 8) != 8) {
+				close(c->fd);
+				c->fd = -1;
+			} else {
+				flock(c->fd, LOCK_UN);
+			}
+		}
+	}
+	c->next++;
+	return s;
+}
+
+void shape_cache_close(shape_cache_t *c)
+{
+	if (c->base != NULL) {
+		munmap((void *) (c->base - SH_WORDS), c->bytes);
+	}
+	if (c->fd >= 0) {
+		close(c->fd);
+	}
+	c->base = NULL;
+	c->fd = -1;
+}
@@ -0,0 +1,111 @@
+/* Shapes of random binary trees without building them, and a store of them
+ * on disk so every run reduces with the same associations.
+ *
+ * A shape over n leaves is its 2n-1 nodes in preorder, one bit each, 1 for
+ * an inner node and 0 for a leaf, which is all a full binary tree needs.
+ * shape_eval reduces values in that tree as they are produced, in leaf
+ * order, with a stack as deep as the tree. Shapes are drawn with rand() by
+ * Algorithm R, as grow_random_binary_tree draws them, and inner nodes add
+ * as eval_tree_sum does, so with the same rand() state shape_eval gives what
+ * random_reduction_tree gives, to the bit.
+ *
+ * The shapes after srand(seed) only depend on n, seed and how many were
+ * drawn before, not on the values reduced. With SHAPE_CACHE=<dir> they are
+ * kept in <dir>/shapes-<n>-<seed>.bin, mapped read-only, and drawn and
+ * appended only past its end; every distribution, precision and operator
+ * then reads the same set. Runs sharing a file append the same bytes, and
+ * its count of shapes only goes up, whichever run writes last. A file
+ * drawn with another C library's rand() is ignored. Every shape read
+ * is checked to be a tree over n leaves; from the first that is not (a
+ * record zeroed or cut short), shapes are drawn and written over it.
+ */
+#ifndef TREE_SHAPE_HXX
+#define TREE_SHAPE_HXX
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Files stop growing past this many bytes; later shapes are only drawn */
+#define SHAPE_CACHE_MAX (1LL << 30)
+
+typedef struct tree_shape {
+	long long leaves;
+	const uint64_t *bits;  // Preorder, bit i of node i; NULL if too big to draw
+} tree_shape_t;
+
+/* 64-bit words of a shape over n leaves */
+long long shape_words(long long leaves);
+
+/* Draw a shape with rand(), into bits */
+void shape_draw(long long leaves, std::vector<uint64_t> &bits);
+
+/* Whether bits are a full binary tree over leaves in preorder, with the
+ * bits past its 2 leaves - 1 nodes clear, as shape_draw writes them. A
+ * record of the store that is zeroed or cut short is not. */
+bool shape_valid(const uint64_t *bits, long long leaves);
+
+typedef struct shape_cache {
+	long long leaves;
+	unsigned int seed;
+	int fd;                       // -1 without a file
+	const uint64_t *base;         // Shapes in the file, NULL if none
+	size_t bytes;
+	long long stored;             // Shapes in the mapping
+	long long next;               // Shapes handed out
+	long long owed;               // rand() calls skipped by reading shapes
+	std::vector<uint64_t> drawn;  // The last shape drawn
+} shape_cache_t;
+
+/* Shapes over leaves after srand(seed), stored in dir, or only drawn if dir
+ * is empty or the file can't be used (a reason is in msg, not an error).
+ * Opening calls srand(seed), so open before drawing anything else. */
+void shape_cache_open(const std::string &dir, long long leaves, unsigned int seed,
+                      shape_cache_t *c, std::string &msg);
+/* $SHAPE_CACHE, or "" */
+std::string shape_cache_dir();
+/* The next shape, valid until the next call */
+tree_shape_t shape_cache_next(shape_cache_t *c);
+void shape_cache_close(shape_cache_t *c);
+
+/* Reduce in shape s the values next() returns, one per leaf in order.
+ * Returns NaN and height -1 for a shape too big to draw. */
+template <typename FLOAT_T, typename NEXT>
+FLOAT_T shape_eval(const tree_shape_t &s, NEXT next, bool is_sum, long long *height)
+{
+	const FLOAT_T init = is_sum ? 0. : 1.;
+	/* Inner nodes on the path to the current leaf, with the left value
+	 * once it is known */
+	std::vector<std::pair<FLOAT_T, bool> > stack;
+	long long i, nodes = 2 * s.leaves - 1;
+	FLOAT_T v = init;
+
+	*height = -1;
+	if (s.bits == NULL) {
+		/* Not numeric_limits, which gives scaled_double() (zero) for it */
+		return FLOAT_T(std::nan(""));
+	}
+	*height = 0;
+	for (i = 0; i < nodes; i++) {
+		if ((s.bits[i / 64] >> (i % 64)) & 1) {
+			stack.push_back(std::make_pair(init, false));
+			continue;
+		}
+		v = next();
+		*height = std::max(*height, (long long) stack.size());
+		while (!stack.empty() && stack.back().second) {
+			/* As eval_tree_sum: acc = 0, acc += left, acc += right */
+			v = is_sum ? (init + stack.back().first) + v : (init * stack.back().first) * v;
+			stack.pop_back();
+		}
+		if (!stack.empty()) {
+			stack.back() = std::make_pair(v, true);
+		}
+	}
+	return v;
+}
+
+#endif
@@ -0,0 +1,202 @@
+/* Memory-mapped binary vectors. See vec_map.hxx */
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vec_map.hxx"
+
+static size_t elem_size(vec_kind_t kind)
+{
+	return kind == VEC_F64 ? sizeof(double) : sizeof(float);
+}
+
+static void put_le(unsigned char *p, uint64_t x, int bytes)
+{
+	for (int i = 0; i < bytes; i++) {
+		p[i] = (unsigned char) (x >> (8 * i));
+	}
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes)
+{
+	uint64_t x = 0;
+	for (int i = bytes - 1; i >= 0; i--) {
+		x = (x << 8) | p[i];
+	}
+	return x;
+}
+
+/* Byte offsets of the fields, independent of struct padding */
+enum {
+	VH_MAGIC = 0, VH_VERSION = 8, VH_ELEM = 12, VH_N = 16, VH_SEED = 24,
+	VH_BLOCK = 28, VH_LE = 32, VH_DISTR = 36
+};
+
+void vec_header_pack(const vec_header_t &h, unsigned char *p)
+{
+	memset(p, 0, VEC_HEADER_BYTES);
+	memcpy(p + VH_MAGIC, h.magic, sizeof(h.magic));
+	put_le(p + VH_VERSION, h.version, 4);
+	put_le(p + VH_ELEM, h.elem_size, 4);
+	put_le(p + VH_N, h.n, 8);
+	put_le(p + VH_SEED, h.seed, 4);
+	put_le(p + VH_BLOCK, h.block, 4);
+	put_le(p + VH_LE, h.little_endian, 4);
+	memcpy(p + VH_DISTR, h.distr, sizeof(h.distr));
+}
+
+int vec_header_unpack(const unsigned char *p, vec_header_t *h)
+{
+	if (memcmp(p, VEC_MAGIC, sizeof(VEC_MAGIC)) != 0) {
+		return 1;
+	}
+	memcpy(h->magic, p + VH_MAGIC, sizeof(h->magic));
+	h->version = (uint32_t) get_le(p + VH_VERSION, 4);
+	h->elem_size = (uint32_t) get_le(p + VH_ELEM, 4);
+	h->n = get_le(p + VH_N, 8);
+	h->seed = (uint32_t) get_le(p + VH_SEED, 4);
+	h->block = (uint32_t) get_le(p + VH_BLOCK, 4);
+	h->little_endian = (uint32_t) get_le(p + VH_LE, 4);
+	memcpy(h->distr, p + VH_DISTR, sizeof(h->distr));
+	h->distr[sizeof(h->distr) - 1] = '\0';
+	return 0;
+}
+
+uint32_t vec_little_endian()
+{
+	const uint16_t one = 1;
+	return *(const unsigned char *) &one;
+}
+
+/* Bytes before the data of the open file fd of size bytes, or -1 if the
+ * file does not hold kind in the byte order of this machine */
+static long long data_offset(int fd, size_t bytes, vec_kind_t kind)
+{
+	unsigned char p[VEC_HEADER_BYTES];
+	vec_header_t h;
+	if (bytes >= VEC_HEADER_BYTES && pread(fd, p, VEC_HEADER_BYTES, 0) == VEC_HEADER_BYTES
+			&& vec_header_unpack(p, &h) == 0) {
+		if (h.elem_size != elem_size(kind) || h.little_endian != vec_little_endian()
+				|| h.n * h.elem_size != bytes - VEC_HEADER_BYTES) {
+			return -1;
+		}
+		return VEC_HEADER_BYTES;
+	}
+	return bytes % elem_size(kind) == 0 ? 0 : -1;
+}
+
+int parse_vec_files(std::string description, vec_kind_t *kind, std::string *a, std::string *b)
+{
+	size_t comma;
+	if (description.compare(0, 4, "f64:") == 0) {
+		*kind = VEC_F64;
+	} else if (description.compare(0, 4, "f32:") == 0) {
+		*kind = VEC_F32;
+	} else {
+		return 1;
+	}
+	description = description.substr(4);
+	comma = description.find(',');
+	*a = description.substr(0, comma);
+	*b = comma == std::string::npos ? "" : description.substr(comma + 1);
+	return a->empty() ? 1 : 0;
+}
+
+long long vec_file_len(const std::string &path, vec_kind_t kind)
+{
+	struct stat st;
+	long long off;
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	off = fstat(fd, &st) == 0 ? data_offset(fd, st.st_size, kind) : -1;
+	close(fd);
+	return off < 0 ? -1 : (long long) ((st.st_size - off) / elem_size(kind));
+}
+
+int vec_map_open(const std::string &path, vec_kind_t kind, vec_map_t *m, std::string &msg)
+{
+	int fd;
+	long long off = -1;
+	struct stat st;
+
+	m->base = NULL;
+	m->bytes = 0;
+	m->data = NULL;
+	m->n = 0;
+	m->kind = kind;
+	fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		msg = "Could not open " + path + ": " + strerror(errno);
+		return 1;
+	}
+	if (fstat(fd, &st) == 0) {
+		off = data_offset(fd, st.st_size, kind);
+	}
+	if (off < 0 || st.st_size == off) {
+		msg = path + " is empty or not a whole number of "
+		      + (kind == VEC_F64 ? "float64" : "float32") + " elements";
+		close(fd);
+		return 1;
+	}
+	m->base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (m->base == MAP_FAILED) {
+		m->base = NULL;
+		msg = "Could not map " + path + ": " + strerror(errno);
+		return 1;
+	}
+	m->bytes = st.st_size;
+	m->data = (const char *) m->base + off;
+	m->n = (long long) ((st.st_size - off) / elem_size(kind));
+	return 0;
+}
+
+void vec_map_close(vec_map_t *m)
+{
+	if (m->base != NULL) {
+		munmap(m->base, m->bytes);
+	}
+	m->base = NULL;
+	m->bytes = 0;
+	m->data = NULL;
+	m->n = 0;
+}
+
+void vec_map_advise(const vec_map_t &m, long long first, long long count)
+{
+	size_t page = (size_t) sysconf(_SC_PAGESIZE), lo, hi;
+	char *start;
+
+	if (m.base == NULL || count <= 0) {
+		return;
+	}
+	lo = (size_t) (m.data - (const char *) m.base) + (size_t) first * elem_size(m.kind);
+	hi = lo + (size_t) count * elem_size(m.kind);
+	/* madvise wants a page-aligned start */
+	lo -= lo % page;
+	start = (char *) m.base + lo;
+	madvise(start, hi - lo, MADV_SEQUENTIAL);
+	madvise(start, hi - lo, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+	madvise(start, hi - lo, MADV_HUGEPAGE);
+#endif
+}
+
+const double *vec_map_doubles(const vec_map_t &m, long long first, long long count, double *buf)
+{
+	const float *f;
+	if (m.kind == VEC_F64) {
+		return (const double *) m.data + first;
+	}
+	f = (const float *) m.data + first;
+	for (long long i = 0; i < count; i++) {
+		buf[i] = f[i];
+	}
+	return buf;
+}
@@ -0,0 +1,81 @@
+/* Vectors read from raw binary files instead of generated by parse_distr:
+ * float64 or float32 elements in the byte order of the machine, after an
+ * optional vec_header_t page, as written by gen_random <n> <distr>
+ * f64|f32[+header] <file>. The file is mapped
+ * read-only rather than read, so a float64 file is used in place, pages are
+ * only read once touched, and a rank that only touches its slice only
+ * reads its slice. float32 has to be widened to double by the caller.
+ *
+ * In place of a distribution, assoc_test and dotprod_mpi take
+ *   f64:<file> or f32:<file>          the vector to reduce, and for
+ *   f64:<a file>,<b file>             dotprod_mpi the two vectors to multiply
+ * With one file dotprod_mpi takes b to be all ones, so it reduces the file.
+ */
+#ifndef VEC_MAP_HXX
+#define VEC_MAP_HXX
+
+#include <stdint.h>
+#include <string>
+
+#define VEC_MAGIC "REDVEC1"
+#define VEC_VERSION 1
+/* The header takes a whole page so the data after it stays page aligned,
+ * for mmap and for O_DIRECT writes */
+#define VEC_HEADER_BYTES 4096
+
+/* Optional header of a vector file, little-endian whatever the machine.
+ * Block b of the data was generated from seeds derived from (seed, b), or
+ * with block 0 all of it from the one stream of set_seed(seed, 0); see
+ * gen_random.cxx. */
+typedef struct vec_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t elem_size;      // 8 or 4
+	uint64_t n;              // Elements
+	uint32_t seed;
+	uint32_t block;          // Elements per seeded block, 0 for one stream
+	uint32_t little_endian;  // Byte order of the data, 1 or 0
+	char distr[64];          // parse_distr description, NUL terminated
+} vec_header_t;
+
+/* Header as bytes, and back. 0 on success, 1 if p is not a header. */
+void vec_header_pack(const vec_header_t &h, unsigned char *p);
+int vec_header_unpack(const unsigned char *p, vec_header_t *h);
+/* 1 on a little-endian machine, else 0 */
+uint32_t vec_little_endian();
+
+typedef enum vec_kind {
+	VEC_F64,
+	VEC_F32
+} vec_kind_t;
+
+typedef struct vec_map {
+	void *base;        // The mapping, NULL if none
+	size_t bytes;
+	const char *data;  // First element, after any header
+	long long n;       // Elements in the file
+	vec_kind_t kind;
+} vec_map_t;
+
+/* "f64:..." or "f32:...", split into the paths after the colon.
+ * 0 on success, 1 if description does not name files. */
+int parse_vec_files(std::string description, vec_kind_t *kind, std::string *a, std::string *b);
+
+/* Elements in path, -1 if it can't be read, its size is not a whole
+ * number of elements or its header is for the other kind */
+long long vec_file_len(const std::string &path, vec_kind_t kind);
+
+/* 0 on success, 1 with a reason in msg */
+int vec_map_open(const std::string &path, vec_kind_t kind, vec_map_t *m, std::string &msg);
+void vec_map_close(vec_map_t *m);
+
+/* Tell the kernel elements [first, first + count) are about to be read in
+ * order: read-ahead, and huge pages where the file system supports them.
+ * Only hints, so failures are ignored. */
+void vec_map_advise(const vec_map_t &m, long long first, long long count);
+
+/* Elements [first, first + count) as doubles. A float64 file returns a
+ * pointer into the mapping; a float32 file is widened into buf. */
+const double *vec_map_doubles(const vec_map_t &m, long long first, long long count, double *buf);
+
+#endif